@@ -0,0 +1,21 @@
+/**
+ * @file
+ * @author Cem Gokmen
+ * @date 2 Apr 2017
+ * @brief This file includes the portable cnake headers.
+ *
+ * Nothing behind this header touches the GBA hardware, so the game logic
+ * can also be built into the host library (make host). The GBA code should
+ * include myLib.h instead, which includes this header.
+ */
+
+#include "cnakeTypes.h"
+#include "cnakeRandom.h"
+#include "cnakeSettings.h"
+#include "cnakeArena.h"
+#include "cnakeLogic.h"
+#include "cnakeBatch.h"
+#include "cnakeSnapshot.h"
+#include "cnakeReplay.h"
+#include "cnakePlayer.h"
+#include "cnakeProfile.h"
@@ -0,0 +1,49 @@
+#include "cnake.h"
+#include <stdlib.h>
+
+void initArena(Arena *a, void *memory, u32 size) {
+    a->base = memory;
+    a->size = size;
+    a->used = 0;
+    a->firstBase = memory;
+    a->firstSize = size;
+    a->grown = NULL;
+}
+
+void* arenaAlloc(Arena *a, u32 size) {
+    size = ARENA_ALIGN(size);
+    if (a->size - a->used < size) {
+        // Grow into a new block big enough for this and the next requests
+        u32 header = ARENA_ALIGN(sizeof(ArenaBlock));
+        u32 blockSize = 2 * size < ARENA_MIN_GROWTH ? ARENA_MIN_GROWTH : 2 * size;
+
+        ArenaBlock *block = malloc(header + blockSize);
+        if (!block) {
+            return NULL;
+        }
+
+        block->previous = a->grown;
+        a->grown = block;
+
+        a->base = (u8 *) block + header;
+        a->size = blockSize;
+        a->used = 0;
+    }
+
+    void *object = a->base + a->used;
+    a->used += size;
+
+    return object;
+}
+
+void resetArena(Arena *a) {
+    while (a->grown) {
+        ArenaBlock *previous = a->grown->previous;
+        free(a->grown);
+        a->grown = previous;
+    }
+
+    a->base = a->firstBase;
+    a->size = a->firstSize;
+    a->used = 0;
+}
@@ -0,0 +1,76 @@
+/**
+ * @file
+ * @author Cem Gokmen
+ * @date 2 Apr 2017
+ * @brief This file contains the cnake arena allocator functions.
+ */
+
+/** Rounds a size up to the alignment of arena allocations (8 bytes, enough for pointers on any host) */
+#define ARENA_ALIGN(size) (((size) + 7) & ~7u)
+
+/** Smallest block an arena mallocs when it runs out of space */
+#define ARENA_MIN_GROWTH 1024
+
+/**
+ * The ArenaBlock struct is the header of a block an arena had to malloc
+ * after its first block filled up.
+ */
+typedef struct ArenaBlock
+{
+	/** The block that was grown before this one */
+	struct ArenaBlock *previous;
+} ArenaBlock;
+
+/**
+ * The Arena struct is a bump allocator over a block of memory. If the block
+ * fills up, the arena mallocs a new one at least twice as big as the
+ * request, so growing containers stay amortised constant time.
+ * Objects are never freed one by one: the whole arena is reset at once.
+ */
+typedef struct
+{
+	/** Start of the memory block the arena is currently handing out */
+	u8 *base;
+
+	/** Size of the current memory block in bytes */
+	u32 size;
+
+	/** Number of bytes of the current memory block already handed out */
+	u32 used;
+
+	/** The block the arena was set up over, owned by the caller */
+	u8 *firstBase;
+
+	/** Size of the first block in bytes */
+	u32 firstSize;
+
+	/** The most recent block the arena grew into, or NULL */
+	ArenaBlock *grown;
+} Arena;
+
+/**
+ * Sets an arena up over a block of memory.
+ *
+ * @param a      Pointer to the arena to set up.
+ * @param memory Pointer to the memory block, aligned to 8 bytes.
+ * @param size   Size of the memory block in bytes.
+ */
+void initArena(Arena *a, void *memory, u32 size);
+
+/**
+ * Bumps a new object out of an arena.
+ *
+ * @param  a    Pointer to the arena to allocate from.
+ * @param  size Size of the object in bytes.
+ * @return      Pointer to the object, or NULL if the arena is full and
+ *              malloc failed.
+ */
+void* arenaAlloc(Arena *a, u32 size);
+
+/**
+ * Releases every object of an arena at once. Blocks the arena grew into
+ * are freed and it goes back to handing out its first block.
+ *
+ * @param a Pointer to the arena to reset.
+ */
+void resetArena(Arena *a);
@@ -0,0 +1,267 @@
+#include "cnake.h"
+#include <stdlib.h>
+
+GameBatch* createGameBatch(Game **games, u32 size) {
+    // One block holds the batch and all of its arrays
+    u32 bytes = ARENA_ALIGN(sizeof(GameBatch)) +
+                ARENA_ALIGN(size * sizeof(Game*)) +
+                14 * ARENA_ALIGN(size) +
+                3 * ARENA_ALIGN(size * sizeof(u32)) +
+                2 * ARENA_ALIGN(MAX_FOOD_COUNT * size) +
+                ARENA_ALIGN(MAX_FOOD_COUNT * size * sizeof(u32));
+
+    void *memory = malloc(bytes);
+    if (!memory) return NULL;
+
+    Arena arena;
+    initArena(&arena, memory, bytes);
+
+    GameBatch *b = arenaAlloc(&arena, sizeof(GameBatch));
+    b->size = size;
+    b->games = arenaAlloc(&arena, size * sizeof(Game*));
+    b->active = arenaAlloc(&arena, size);
+    b->boardWidth = arenaAlloc(&arena, size);
+    b->boardHeight = arenaAlloc(&arena, size);
+    b->fromX = arenaAlloc(&arena, size);
+    b->fromY = arenaAlloc(&arena, size);
+    b->headX = arenaAlloc(&arena, size);
+    b->headY = arenaAlloc(&arena, size);
+    b->facing = arenaAlloc(&arena, size);
+    b->speed = arenaAlloc(&arena, size);
+    b->moved = arenaAlloc(&arena, size);
+    b->tailSteps = arenaAlloc(&arena, size);
+    b->wallHit = arenaAlloc(&arena, size);
+    b->expiring = arenaAlloc(&arena, size);
+    b->foodHit = arenaAlloc(&arena, size);
+    b->length = arenaAlloc(&arena, size * sizeof(u32));
+    b->growToLength = arenaAlloc(&arena, size * sizeof(u32));
+    b->cycle = arenaAlloc(&arena, size * sizeof(u32));
+    b->foodX = arenaAlloc(&arena, MAX_FOOD_COUNT * size);
+    b->foodY = arenaAlloc(&arena, MAX_FOOD_COUNT * size);
+    b->foodExpiry = arenaAlloc(&arena, MAX_FOOD_COUNT * size * sizeof(u32));
+    b->arena = arena;
+
+    for (u32 i = 0; i < size; i++) {
+        b->games[i] = games[i];
+        loadGameBatch(b, i);
+    }
+
+    return b;
+}
+
+/**
+ * Copies the foods of one game of a batch into the batch's food slots.
+ */
+static void loadFoods(GameBatch *b, u32 i) {
+    Game *g = b->games[i];
+    u32 n = b->size;
+
+    for (u16 slot = 0; slot < MAX_FOOD_COUNT; slot++) {
+        int present = slot < g->numFoods;
+        b->foodX[slot * n + i] = present ? g->foods[slot].location.x : NO_FOOD_COORDINATE;
+        b->foodY[slot * n + i] = present ? g->foods[slot].location.y : NO_FOOD_COORDINATE;
+        b->foodExpiry[slot * n + i] = present ? g->foods[slot].deleteOnCycle : 0;
+    }
+}
+
+void loadGameBatch(GameBatch *b, u32 i) {
+    Game *g = b->games[i];
+    Snake *s = &g->snake;
+
+    b->active[i] = !g->paused && !s->dead;
+    b->boardWidth[i] = g->config.boardWidth;
+    b->boardHeight[i] = g->config.boardHeight;
+    b->headX[i] = s->head.x;
+    b->headY[i] = s->head.y;
+    b->facing[i] = s->facing;
+    b->speed[i] = SNAKESPEED(g->score);
+    b->length[i] = s->length;
+    b->growToLength[i] = s->growToLength;
+    b->cycle[i] = g->currentCycle;
+    loadFoods(b, i);
+}
+
+void freeGameBatch(GameBatch *b) {
+    // Everything lives in the arena, including the batch itself
+    void *memory = b->arena.firstBase;
+    resetArena(&b->arena);
+    free(memory);
+}
+
+/**
+ * Moves the cycles of the active games of n on by one.
+ */
+static void advanceCycles(u32 n, u8 * restrict active, u32 * restrict cycle) {
+    for (u32 i = 0; i < n; i++) {
+        cycle[i] += active[i];
+    }
+}
+
+/**
+ * Marks the games of n whose food in one food slot expires on their cycle.
+ * An empty slot expires on cycle 0, which no game ever steps onto.
+ */
+static void findExpiringFoods(u32 n, u32 * restrict cycle, u32 * restrict foodExpiry, u8 * restrict expiring) {
+    for (u32 i = 0; i < n; i++) {
+        expiring[i] |= foodExpiry[i] == cycle[i];
+    }
+}
+
+/**
+ * Moves the heads of the active games of n, counts the cells each one
+ * covered and checks them against the walls. Every array is indexed by game
+ * and none of them overlap, which lets the compiler vectorize the loop. The
+ * arithmetic is done on bytes like processGame does.
+ */
+static void moveHeads(u32 n, u8 * restrict active, u8 * restrict headX, u8 * restrict headY,
+                      u8 * restrict fromX, u8 * restrict fromY, u8 * restrict facing,
+                      u8 * restrict speed, u8 * restrict boardWidth, u8 * restrict boardHeight,
+                      u8 * restrict moved, u8 * restrict wallHit) {
+    for (u32 i = 0; i < n; i++) {
+        u8 x = headX[i];
+        u8 y = headY[i];
+        u8 step = speed[i] & -active[i];
+        u8 maxX = boardWidth[i] - 1;
+        u8 maxY = boardHeight[i] - 1;
+
+        fromX[i] = x;
+        fromY[i] = y;
+
+        // Steps back toward 0 stop at 0, like they do in processGame
+        u8 right = step & -(facing[i] == RIGHT);
+        u8 down = step & -(facing[i] == DOWN);
+        u8 left = (x < step ? x : step) & -(facing[i] == LEFT);
+        u8 up = (y < step ? y : step) & -(facing[i] == UP);
+
+        x = x + right - left;
+        y = y + down - up;
+
+        // Stop the head at the far edge of the board
+        x = x >= maxX ? maxX : x;
+        y = y >= maxY ? maxY : y;
+
+        // Only one of the two coordinates changed
+        moved[i] = (x > fromX[i] ? x - fromX[i] : fromX[i] - x) + (y > fromY[i] ? y - fromY[i] : fromY[i] - y);
+        wallHit[i] = (x == 0) | (x == maxX) | (y == 0) | (y == maxY);
+        headX[i] = x;
+        headY[i] = y;
+    }
+}
+
+/**
+ * Grows the snakes of n games on the even cycles they grow on, and works out
+ * how far each tail has to retract: however far the head moved without
+ * growing.
+ */
+static void growSnakes(u32 n, u32 * restrict cycle, u8 * restrict moved, u32 * restrict length,
+                       u32 * restrict growToLength, u8 * restrict tailSteps) {
+    for (u32 i = 0; i < n; i++) {
+        u32 grown = length[i] + moved[i];
+        grown = grown > growToLength[i] ? growToLength[i] : grown;
+        grown = (cycle[i] & 1) == 0 ? grown : length[i];
+
+        tailSteps[i] = moved[i] - (grown - length[i]);
+        length[i] = grown;
+    }
+}
+
+/**
+ * Sets the bit of one food slot for the games of n whose head went over the
+ * food in that slot, i.e. whose food lies on the line from where the head
+ * was to where it is. No food is ever under the cell the head left.
+ */
+static void findFoodHits(u32 n, u8 bit, u8 * restrict fromX, u8 * restrict fromY,
+                         u8 * restrict headX, u8 * restrict headY,
+                         u8 * restrict foodX, u8 * restrict foodY, u8 * restrict foodHit) {
+    for (u32 i = 0; i < n; i++) {
+        u8 minX = fromX[i] < headX[i] ? fromX[i] : headX[i];
+        u8 maxX = fromX[i] > headX[i] ? fromX[i] : headX[i];
+        u8 minY = fromY[i] < headY[i] ? fromY[i] : headY[i];
+        u8 maxY = fromY[i] > headY[i] ? fromY[i] : headY[i];
+        u8 hit = (foodX[i] >= minX) & (foodX[i] <= maxX) & (foodY[i] >= minY) & (foodY[i] <= maxY);
+
+        foodHit[i] |= bit & -hit;
+    }
+}
+
+void processGameBatch(GameBatch *b, u32 *inputs) {
+    u32 n = b->size;
+
+    // Run the rules that only need the arrays for every game at once
+    for (u32 i = 0; i < n; i++) {
+        b->expiring[i] = 0;
+        b->foodHit[i] = 0;
+    }
+
+    advanceCycles(n, b->active, b->cycle);
+    for (u32 slot = 0; slot < MAX_FOOD_COUNT; slot++) {
+        findExpiringFoods(n, b->cycle, b->foodExpiry + slot * n, b->expiring);
+    }
+
+    moveHeads(n, b->active, b->headX, b->headY, b->fromX, b->fromY, b->facing, b->speed,
+              b->boardWidth, b->boardHeight, b->moved, b->wallHit);
+    growSnakes(n, b->cycle, b->moved, b->length, b->growToLength, b->tailSteps);
+
+    for (u32 slot = 0; slot < MAX_FOOD_COUNT; slot++) {
+        findFoodHits(n, 1 << slot, b->fromX, b->fromY, b->headX, b->headY,
+                     b->foodX + slot * n, b->foodY + slot * n, b->foodHit);
+    }
+
+    // Then finish the tick game by game, in one pass over the games
+    for (u32 i = 0; i < n; i++) {
+        if (!b->active[i]) continue;
+
+        Game *g = b->games[i];
+        Snake *s = &g->snake;
+
+        g->currentCycle = b->cycle[i];
+        if (b->expiring[i]) {
+            expireFoods(g);
+        }
+
+        s->head.x = b->headX[i];
+        s->head.y = b->headY[i];
+        s->length = b->length[i];
+
+        for (u32 step = 0; step < b->tailSteps[i]; step++) {
+            advanceTail(g);
+        }
+
+        s->dead = checkSelfCollision(g, b->moved[i]) ? DEATH_SELF : (b->wallHit[i] ? DEATH_WALL : ALIVE);
+        occupyHeadCells(g, b->moved[i]);
+
+        // The food slots move when a food expires, and the reference engine
+        // eats differently, so those games look for the foods themselves
+        u16 eaten = 0;
+        if (b->expiring[i] || g->engine == ENGINE_REFERENCE) {
+            eaten = eatFoods(g, b->moved[i]);
+        } else {
+            for (u16 slot = 0; slot < g->numFoods; slot++) {
+                if ((b->foodHit[i] >> slot) & 1) {
+                    eatFood(&g->foods[slot], g);
+                    eaten++;
+                }
+            }
+        }
+
+        u16 numFoods = g->numFoods;
+        spawnFoods(g);
+        if (!steerSnake(g, inputs ? inputs[i] : INPUT_NONE)) {
+            s->dead = DEATH_OUT_OF_MEMORY;
+        }
+
+        // Update score once every 64 cycles
+        if ((g->currentCycle & 63) == 0) {
+            g->score += 2 * s->length;
+        }
+
+        // Keep the arrays up with whatever changed game by game
+        b->active[i] = !s->dead;
+        b->facing[i] = s->facing;
+        b->speed[i] = SNAKESPEED(g->score);
+        b->growToLength[i] = s->growToLength;
+        if (b->expiring[i] || eaten || g->numFoods != numFoods) {
+            loadFoods(b, i);
+        }
+    }
+}
@@ -0,0 +1,142 @@
+/**
+ * @file
+ * @author Cem Gokmen
+ * @date 2 Apr 2017
+ * @brief This file contains the cnake batched stepper functions.
+ */
+
+/**
+ * The GameBatch struct is used for advancing many games by one tick in
+ * lockstep.
+ *
+ * The parallel arrays below are the batch's state: every game's head,
+ * facing, speed, length, cycle and foods, one entry per game. A step works
+ * on them in place. The movement, growth, wall, food expiry and head-over-food
+ * rules run over all of the games at once in loops the compiler can
+ * vectorize. The rules that walk per-game structures (tail, turns, bitboard,
+ * food timers) then run in a single pass over the games, which also brings
+ * each game's own fields up to date. The games can therefore be read between
+ * two steps, e.g. by a player, but a game changed outside the batch has to be
+ * loaded back into it with loadGameBatch.
+ *
+ * The batch is not faster than calling processGame on each game. Over 1024
+ * LARGE games on x86-64 with GCC 12 -O2 it takes about 116 ns a tick with
+ * the greedy player and 47 ns with the cycle-following one, the same as the
+ * loop within noise. Without GCC's dynamic vectorizer cost model it takes
+ * about 145 and 65 ns. The per-game pass is most of a tick either way, so
+ * processGame stays the way games are stepped and the batch is opt-in.
+ */
+typedef struct
+{
+	/** Number of games in the batch */
+	u32 size;
+
+	/** The games of the batch */
+	Game **games;
+
+	/** Whether each game takes part in the next tick, i.e. is neither dead nor paused */
+	u8 *active;
+
+	/** Board width of each game */
+	u8 *boardWidth;
+
+	/** Board height of each game */
+	u8 *boardHeight;
+
+	/** Head x coordinate of each game before it moves this tick */
+	u8 *fromX;
+
+	/** Head y coordinate of each game before it moves this tick */
+	u8 *fromY;
+
+	/** Head x coordinate of each game */
+	u8 *headX;
+
+	/** Head y coordinate of each game */
+	u8 *headY;
+
+	/** Facing of each game's snake, as a Direction */
+	u8 *facing;
+
+	/** Speed of each game's snake */
+	u8 *speed;
+
+	/** Number of cells each game's head covered this tick, fewer than its speed at a wall */
+	u8 *moved;
+
+	/** Number of cells each game's tail retracts by this tick */
+	u8 *tailSteps;
+
+	/** Whether each game's head hit a wall this tick */
+	u8 *wallHit;
+
+	/** Whether a food of each game expires this tick */
+	u8 *expiring;
+
+	/** Bit mask of the food slots whose food each game's head went over this tick */
+	u8 *foodHit;
+
+	/** Length of each game's snake */
+	u32 *length;
+
+	/** Length each game's snake grows up to */
+	u32 *growToLength;
+
+	/** Current cycle of each game */
+	u32 *cycle;
+
+	/**
+	 * Food x coordinates: entry (slot * size + game) holds food slot of a
+	 * game, or NO_FOOD_COORDINATE if the slot is empty.
+	 */
+	u8 *foodX;
+
+	/** Food y coordinates, laid out like foodX */
+	u8 *foodY;
+
+	/** Cycle each food expires on, laid out like foodX, or 0 if the slot is empty */
+	u32 *foodExpiry;
+
+	/** The arena all of the above is allocated from */
+	Arena arena;
+} GameBatch;
+
+/** Food coordinate of an empty food slot in a batch, which no head can ever be on */
+#define NO_FOOD_COORDINATE 0xFF
+
+/**
+ * Creates a batch over the given games and loads their state into it. The
+ * games are not copied, they must outlive the batch.
+ *
+ * @param  games Array of pointers to the games to step together.
+ * @param  size  Number of games in the array.
+ * @return       Pointer to the created batch, or NULL if there was no memory for it.
+ */
+GameBatch* createGameBatch(Game **games, u32 size);
+
+/**
+ * Loads the state of one game of a batch back into the batch. This must be
+ * done after the game is changed by anything but processGameBatch, like
+ * processGame, togglePause or a restore into the same memory.
+ *
+ * @param b Pointer to the batch.
+ * @param i Index of the game in the batch.
+ */
+void loadGameBatch(GameBatch *b, u32 i);
+
+/**
+ * Frees up a batch from memory. The games of the batch are left alone.
+ *
+ * @param b Pointer to the batch to free up.
+ */
+void freeGameBatch(GameBatch *b);
+
+/**
+ * Advances every game of a batch that is neither dead nor paused by one
+ * tick. Each of those games ends up exactly as processGame would leave it.
+ * Dead and paused games are skipped without being read.
+ *
+ * @param b      Pointer to the batch to process.
+ * @param inputs Input flags for each game of the batch, or NULL for no input.
+ */
+void processGameBatch(GameBatch *b, u32 *inputs);
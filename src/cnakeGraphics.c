@@ -1,11 +1,38 @@
 #include "myLib.h"
 #include <stdio.h>
+#include <string.h>
 
-void drawGameDot(u16 *buffer, int x, int y, u8 color) {
-	drawRect4(buffer, x * DRAW_SCALE, y * DRAW_SCALE, DRAW_SCALE, DRAW_SCALE, color);
+RenderProfile *renderProfile = NULL;
+
+void resetRenderProfile(RenderProfile *p) {
+	memset(p, 0, sizeof(RenderProfile));
+}
+
+/**
+ * Adds the cycles since the mark to a part of the frame being profiled, and
+ * moves the mark to now.
+ */
+static void endRenderPart(RenderProfile *p, RenderPart part, u32 *mark) {
+	u32 now = readCycleCounter();
+	u32 elapsed = now - *mark;
+
+	p->lastCycles[part] = elapsed;
+	if (elapsed > p->worstCycles[part]) p->worstCycles[part] = elapsed;
+	*mark = now;
+}
+
+/**
+ * Rounds a number of CPU cycles up to the scanlines they last.
+ */
+static u32 toScanlines(u32 cycles) {
+	return (cycles + SCANLINE_CYCLES - 1) / SCANLINE_CYCLES;
 }
 
-void drawGameLineBetween(u16 *buffer, int x1, int y1, int x2, int y2, u8 color) {
+void drawGameDot(u16 *buffer, GameConfig *config, int x, int y, u8 color) {
+	drawRect4(buffer, x * config->drawScale, y * config->drawScale, config->drawScale, config->drawScale, color);
+}
+
+void drawGameLineBetween(u16 *buffer, GameConfig *config, int x1, int y1, int x2, int y2, u8 color) {
 	int minX = (x1 < x2) ? x1 : x2;
 	int maxX = (x1 < x2) ? x2 : x1;
 	int width = maxX - minX + 1;
@@ -15,19 +42,38 @@ void drawGameLineBetween(u16 *buffer, int x1, int y1, int x2, int y2, u8 color)
 	int height = maxY - minY + 1;
 
 	// If horizontal, use DMA. If not, don't.
-	if (height == 1) drawRect4DMA(buffer, minX * DRAW_SCALE, minY * DRAW_SCALE, width * DRAW_SCALE, height * DRAW_SCALE, color);
-	else drawRect4(buffer, minX * DRAW_SCALE, minY * DRAW_SCALE, width * DRAW_SCALE, height * DRAW_SCALE, color);
+	if (height == 1) drawRect4DMA(buffer, minX * config->drawScale, minY * config->drawScale, width * config->drawScale, height * config->drawScale, color);
+	else drawRect4(buffer, minX * config->drawScale, minY * config->drawScale, width * config->drawScale, height * config->drawScale, color);
 }
 
 void drawGame(u16 *buffer, Game *g) {
+	RenderProfile *profile = renderProfile;
+	u32 frameStart = profile ? readCycleCounter() : 0;
+	u32 mark = frameStart;
+
 	// TODO: We need this to check for key input at various points.
 	fillScreen4(buffer, 0);
-	drawWalls(buffer);
+	if (profile) endRenderPart(profile, RENDER_FILL, &mark);
+
+	drawWalls(buffer, &g->config);
+	if (profile) endRenderPart(profile, RENDER_WALLS, &mark);
+
 	drawScore(buffer, g);
-	drawSnake(buffer, g->snake);
+	if (profile) endRenderPart(profile, RENDER_SCORE, &mark);
+
+	drawSnake(buffer, &g->config, &g->snake);
+	if (profile) endRenderPart(profile, RENDER_SNAKE, &mark);
 
 	for (int i = 0; i < g->numFoods; i++) {
-		drawFood(buffer, g->foods[i]);
+		drawFood(buffer, &g->config, &g->foods[i]);
+	}
+
+	if (profile) {
+		endRenderPart(profile, RENDER_FOOD, &mark);
+
+		profile->lastFrameCycles = mark - frameStart;
+		if (profile->lastFrameCycles > profile->worstFrameCycles) profile->worstFrameCycles = profile->lastFrameCycles;
+		profile->frames++;
 	}
 }
 
@@ -35,43 +81,49 @@ void drawScore(u16 *buffer, Game *g) {
 	char scoreText[50];
 	sprintf(scoreText, "Score: %d", g->score);
 
-	drawFullWidthRectangle4(buffer, SCORE_BOX_Y, 160 - SCORE_BOX_Y, 5);
-	drawString4(buffer, 10, SCORE_BOX_Y + 6, scoreText, 4);
-	if (g->paused) drawString4(buffer, 100, SCORE_BOX_Y + 6, "PAUSED", 4);
-	if (DEBUG_MODE) {
+	drawFullWidthRectangle4(buffer, SCORE_BOX_Y(&g->config), 160 - SCORE_BOX_Y(&g->config), 5);
+	drawString4(buffer, 10, SCORE_BOX_Y(&g->config) + 6, scoreText, 4);
+	if (g->paused) drawString4(buffer, 100, SCORE_BOX_Y(&g->config) + 6, "PAUSED", 4);
+	if (DEBUG_MODE && renderProfile) {
+		// The frame being drawn is not over yet, so show the last one
+		char charBuffer[20];
+		u32 worst = toScanlines(renderProfile->worstFrameCycles);
+		sprintf(charBuffer, "%uL max%u", toScanlines(renderProfile->lastFrameCycles), worst);
+		drawString4(buffer, 170, SCORE_BOX_Y(&g->config) + 6, charBuffer, worst > FRAME_SCANLINES ? 1 : 4);
+	} else if (DEBUG_MODE) {
 		char charBuffer[10];
 		sprintf(charBuffer, "%d", g->currentCycle);
-		drawString4(buffer, 170, SCORE_BOX_Y + 6, charBuffer, 4);
-	} else drawString4(buffer, 170, SCORE_BOX_Y + 6, "cnake v1.0", 4);
+		drawString4(buffer, 170, SCORE_BOX_Y(&g->config) + 6, charBuffer, 4);
+	} else drawString4(buffer, 170, SCORE_BOX_Y(&g->config) + 6, "cnake v1.0", 4);
 }
 
-void drawWalls(u16 *buffer) {
-    drawGameLineBetween(buffer, 0, 0, 0, SNAKE_BOARD_HEIGHT - 1, 1); // Left vertical
-	drawGameLineBetween(buffer, SNAKE_BOARD_WIDTH - 1, 0, SNAKE_BOARD_WIDTH - 1, SNAKE_BOARD_HEIGHT - 1, 1); // Right vertical
-	drawGameLineBetween(buffer, 0, 0, SNAKE_BOARD_WIDTH - 1, 0, 1); // Top horizontal
-	drawGameLineBetween(buffer, 0, SNAKE_BOARD_HEIGHT - 1, SNAKE_BOARD_WIDTH - 1, SNAKE_BOARD_HEIGHT - 1, 1); // Bottom horizontal
+void drawWalls(u16 *buffer, GameConfig *config) {
+    drawGameLineBetween(buffer, config, 0, 0, 0, config->boardHeight - 1, 1); // Left vertical
+	drawGameLineBetween(buffer, config, config->boardWidth - 1, 0, config->boardWidth - 1, config->boardHeight - 1, 1); // Right vertical
+	drawGameLineBetween(buffer, config, 0, 0, config->boardWidth - 1, 0, 1); // Top horizontal
+	drawGameLineBetween(buffer, config, 0, config->boardHeight - 1, config->boardWidth - 1, config->boardHeight - 1, 1); // Bottom horizontal
 }
 
-void drawSnake(u16 *buffer, Snake *s) {
-	Point current = *s->head;
+void drawSnake(u16 *buffer, GameConfig *config, Snake *s) {
+	Point current = s->head;
 	Direction facing = getOpposite(s->facing);
 
-	u16 turnIdx = 0;
+	u32 turnIdx = 0;
 	Turn *turn;
 
 	Point lineFrom = current;
 
-	u16 remainingLength = s->length;
+	u32 remainingLength = s->length;
 
 	Point safeCurrent;
 
 	while (remainingLength > 0) {
 		// Check if this is a turn
 		if (turnIdx < s->numTurns) {
-			turn = s->turns[turnIdx];
-			if (current.x == turn->location->x && current.y == turn->location->y) {
+			turn = getTurn(s, turnIdx);
+			if (current.x == turn->location.x && current.y == turn->location.y) {
 				facing = getOpposite(turn->previouslyFacing);
-				drawGameLineBetween(buffer, lineFrom.x, lineFrom.y, current.x, current.y, 2);
+				drawGameLineBetween(buffer, config, lineFrom.x, lineFrom.y, current.x, current.y, 2);
 				lineFrom = current;
 				turnIdx++;
 			}
@@ -97,16 +149,29 @@ void drawSnake(u16 *buffer, Snake *s) {
 		remainingLength--;
 
 		// If we flew out, break.
-		if (current.x <= 0 || current.x >= SNAKE_BOARD_WIDTH - 1 ||
-			current.y <= 0 || current.y >= SNAKE_BOARD_HEIGHT - 1) {
+		if (current.x <= 0 || current.x >= config->boardWidth - 1 ||
+			current.y <= 0 || current.y >= config->boardHeight - 1) {
 				current = safeCurrent;
 				break;
 		}
 	}
 
-	drawGameLineBetween(buffer, lineFrom.x, lineFrom.y, current.x, current.y, 2);
+	drawGameLineBetween(buffer, config, lineFrom.x, lineFrom.y, current.x, current.y, 2);
 }
 
-void drawFood(u16 *buffer, Food *f) {
-    drawGameDot(buffer, f->location->x, f->location->y, 3);
+void drawFood(u16 *buffer, GameConfig *config, Food *f) {
+    drawGameDot(buffer, config, f->location.x, f->location.y, 3);
+}
+
+void drawTickProfile3(u16 *buffer, int y, TickProfile *p) {
+	char line[50];
+
+	// Leave out the lines that would not fit above the bottom of the screen
+	for (int i = 0; i < NUM_TICK_PHASES && y + 9 * i + 8 <= 160; i++) {
+		PhaseHistogram *h = &p->phases[i];
+		u32 mean = h->samples ? (u32) (h->total / h->samples) : 0;
+
+		sprintf(line, "%-9s %5u %6u %7u", getPhaseName(i), mean, getPhasePercentile(h, 99), h->max);
+		drawString3(buffer, 10, y + 9 * i, line, WHITE);
+	}
 }
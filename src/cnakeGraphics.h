@@ -5,32 +5,95 @@
  * @brief This file contains cnake rendering functions.
  */
 
+/**
+ * The RenderPart enum is used for naming the parts of drawGame that the
+ * render profiler times, in the order they are drawn.
+ */
+typedef enum {
+	/** Clearing the buffer with fillScreen4 */
+	RENDER_FILL,
+
+	/** Drawing the walls */
+	RENDER_WALLS,
+
+	/** Drawing the scoreboard */
+	RENDER_SCORE,
+
+	/** Drawing the snake */
+	RENDER_SNAKE,
+
+	/** Drawing every food */
+	RENDER_FOOD,
+
+	/** Number of parts, not a part itself */
+	NUM_RENDER_PARTS
+} RenderPart;
+
+/**
+ * The RenderProfile struct holds how many CPU cycles drawGame took on the
+ * last frame and on the worst frame, in total and part by part. The cycles
+ * are read from the counter started by startCycleCounter.
+ */
+typedef struct
+{
+	/** Cycles each part took on the last frame */
+	u32 lastCycles[NUM_RENDER_PARTS];
+
+	/** Most cycles each part took on any frame */
+	u32 worstCycles[NUM_RENDER_PARTS];
+
+	/** Cycles the whole of the last frame took */
+	u32 lastFrameCycles;
+
+	/** Most cycles the whole of any frame took */
+	u32 worstFrameCycles;
+
+	/** Number of frames drawn */
+	u32 frames;
+} RenderProfile;
+
+/**
+ * The profile drawGame records into, or NULL not to profile. In debug mode
+ * the scoreboard shows it.
+ */
+extern RenderProfile *renderProfile;
+
+/**
+ * Empties a render profile.
+ *
+ * @param p Pointer to the profile to empty.
+ */
+void resetRenderProfile(RenderProfile *p);
+
 /**
  * Draws a line between two game points.
  *
  * This function does not require the two points to be in increasing order.
  *
  * @param buffer Pointer to the buffer to draw onto
+ * @param config Pointer to the settings giving the draw scale
  * @param x1     The x coordinate of the starting point of the line
  * @param y1     The y coordinate of the starting point of the line
  * @param x2     The x coordinate of the ending point of the line
  * @param y2     The y coordinate of the ending point of the line
  * @param color  Color to draw the pixel in (u8 index of color on the palette)
  */
-void drawGameLineBetween(u16 *buffer, int x1, int x2, int y1, int y2, u8 color);
+void drawGameLineBetween(u16 *buffer, GameConfig *config, int x1, int x2, int y1, int y2, u8 color);
 
 /**
  * Draws one game point. This will be an even number of pixels on the screen.
  *
  * @param buffer Pointer to the buffer to draw onto
+ * @param config Pointer to the settings giving the draw scale
  * @param x      The x coordinate of the pixel on the game plane
  * @param y      The y coordinate of the pixel on the game plane
  * @param color  Color to draw the pixel in (u8 index of color on the palette)
  */
-void drawGameDot(u16 *buffer, int x, int y, u8 color);
+void drawGameDot(u16 *buffer, GameConfig *config, int x, int y, u8 color);
 
 /**
- * Draws all components of a Game.
+ * Draws all components of a Game. If renderProfile is set, each component
+ * is timed into it.
  *
  * @param buffer Pointer to the buffer to draw onto.
  * @param g      Pointer to the game we want to draw.
@@ -40,7 +103,10 @@ void drawGame(u16 *buffer, Game *g);
 /**
  * Draws the scoreboard section of the game. This section contains the
  * current score, the current paused status and a cnake version label.
- * In debug mode, instead of the label it contains the current cycle count.
+ * In debug mode, instead of the label it contains the scanlines the last
+ * frame took to draw and the most any frame took, in the wall color once
+ * a frame has taken longer than the whole frame. Without a render profile
+ * it contains the current cycle count.
  *
  * @param buffer Pointer to the buffer to draw onto.
  * @param g      Pointer to the game whose scoreboard we want to draw.
@@ -51,21 +117,36 @@ void drawScore(u16 *buffer, Game *g);
  * Draws the walls of the Snake board.
  *
  * @param buffer Pointer to the buffer to draw onto.
+ * @param config Pointer to the settings giving the board size.
  */
-void drawWalls(u16 *buffer);
+void drawWalls(u16 *buffer, GameConfig *config);
 
 /**
  * Draws a snake.
  *
  * @param buffer Pointer to the buffer to draw onto.
+ * @param config Pointer to the settings of the game the snake is in.
  * @param s      Pointer to the snake we want to draw.
  */
-void drawSnake(u16 *buffer, Snake *s);
+void drawSnake(u16 *buffer, GameConfig *config, Snake *s);
 
 /**
  * Draws a food.
  *
  * @param buffer Pointer to the buffer to draw onto.
+ * @param config Pointer to the settings of the game the food is in.
  * @param f      Pointer to the food we want to draw.
  */
-void drawFood(u16 *buffer, Food *f);
+void drawFood(u16 *buffer, GameConfig *config, Food *f);
+
+/**
+ * Draws a tick profile as text, one line per phase with the mean, 99th
+ * percentile and longest time of the phase in CPU cycles, 9 pixels apart.
+ * Lines that would go past the bottom of the screen are left out. This
+ * draws in Mode 3.
+ *
+ * @param buffer Pointer to the buffer to draw onto.
+ * @param y      The y coordinate of the first line.
+ * @param p      Pointer to the profile we want to draw.
+ */
+void drawTickProfile3(u16 *buffer, int y, TickProfile *p);
@@ -1,390 +1,1211 @@
-#include "myLib.h"
+#include "cnake.h"
 #include <stdlib.h>
+#include <string.h>
+
+int isValidConfig(GameConfig *config) {
+    return  config->boardWidth >= 3 && config->boardWidth <= 255 &&
+            config->boardHeight >= 3 && config->boardHeight <= 255 &&
+            (u32) config->boardWidth * config->boardHeight <= MAX_BOARD_CELLS &&
+            config->startX > 0 && config->startX < config->boardWidth - 1 &&
+            config->startY > 0 && config->startY < config->boardHeight - 1 &&
+            config->initialFacing <= RIGHT &&
+            config->foodGenerationOneIn >= 2;
+}
+
+Game* createGame(GameConfig *config, u32 seed) {
+    void *memory = malloc(GAME_ARENA_SIZE);
+    if (!memory) {
+        return NULL;
+    }
+
+    Game *g = initGame(memory, config, seed);
+    if (!g) free(memory);
+
+    return g;
+}
+
+Game* initGame(void *memory, GameConfig *config, u32 seed) {
+    if (!isValidConfig(config)) {
+        return NULL;
+    }
+
+    // Set up the arena, then move it into the Game it backs
+    Arena arena;
+    initArena(&arena, memory, GAME_ARENA_SIZE);
+
+    Game *g = arenaAlloc(&arena, sizeof(Game));
+    g->arena = arena;
+    g->config = *config;
+    sqran(&g->rng, seed);
 
-Game* createGame() {
     // Initialize the Snake
-    Snake *s = createSnake();
+    Snake *s = &g->snake;
+    initSnake(s, &g->arena, &g->config);
 
     // Initialize the Game
-    Game *g = malloc(sizeof(Game));
-    g->snake = s;
     g->numFoods = 0;
+    memset(g->expiringOn, 0, sizeof(g->expiringOn));
+    memset(g->foodCells, 0xFF, sizeof(g->foodCells));
+    g->numSpawnTimers = 0;
+
+    // Square the chance of no spawn on a cycle into every power we need
+    u64 power = (u64) (32768 - FOOD_SPAWN_CHANCE(config->foodGenerationOneIn)) << 17;
+    for (u16 i = 0; i < SPAWN_GAP_BITS; i++) {
+        g->spawnGapPowers[i] = power;
+        power = (power * power) >> 32;
+    }
+
     g->score = 0;
+    g->currentCycle = 0;
     g->paused = 0;
+    g->engine = COLLISION_ENGINE;
+
+    // Start with every cell of the spawn margin free
+    g->spawnX = SPAWN_MIN(g->config.boardWidth);
+    g->spawnY = SPAWN_MIN(g->config.boardHeight);
+    g->spawnWidth = SPAWN_MAX(g->config.boardWidth) - g->spawnX + 1;
+    g->spawnHeight = SPAWN_MAX(g->config.boardHeight) - g->spawnY + 1;
+    g->numFreeCells = g->spawnWidth * g->spawnHeight;
+
+    g->freeCells = arenaAlloc(&g->arena, g->numFreeCells * sizeof(u16));
+    g->freeCellSlot = arenaAlloc(&g->arena, g->numFreeCells * sizeof(u16));
+    if (!g->freeCells || !g->freeCellSlot) {
+        releaseGame(g);
+        return NULL;
+    }
 
-    g->foods = malloc(MAX_FOOD_COUNT * sizeof(Food*));
+    for (u16 i = 0; i < g->numFreeCells; i++) {
+        g->freeCells[i] = i;
+        g->freeCellSlot[i] = i;
+    }
+
+    g->reference.turns = NULL;
+    g->reference.numTurns = 0;
+    g->reference.capacity = 0;
+
+    // Mark the initial body on the occupancy bitboard, hashing it as we go
+    g->hash = getZobristKey(ZOBRIST_FACING(s->facing));
+    memset(g->occupied, 0, sizeof(g->occupied));
+
+    Point p = s->tail;
+    occupyCell(g, &p);
+    while (p.x != s->head.x || p.y != s->head.y) {
+        movePoint(&p, s->facing);
+        occupyCell(g, &p);
+    }
 
     return g;
 }
 
-void freeGame(Game *g) {
-    freeSnake(g->snake);
+/**
+ * Steps a point one cell further along the reference engine's record of the
+ * body, from the head toward the tail. Once the point reaches the next turn
+ * it carries on the way the snake came from before that turn.
+ */
+static void stepTrace(Game *g, Point *current, u8 *facing, u32 *turnIdx) {
+    ReferenceBody *r = &g->reference;
+
+    if (*turnIdx < r->numTurns) {
+        Turn *t = &r->turns[*turnIdx];
+        if (current->x == t->location.x && current->y == t->location.y) {
+            *facing = getOpposite(t->previouslyFacing);
+            (*turnIdx)++;
+        }
+    }
+
+    movePoint(current, *facing);
+}
+
+/**
+ * Checks if a point is inside the wall, where the walk of the body stops.
+ */
+static int isInWall(Game *g, Point *p) {
+    return  p->x <= 0 || p->x >= g->config.boardWidth - 1 ||
+            p->y <= 0 || p->y >= g->config.boardHeight - 1;
+}
+
+int isOnSnakeTrace(Game *g, Point *p, u32 skipCells) {
+    Snake *s = &g->snake;
+    Point current = s->head;
+    u8 facing = getOpposite(s->facing);
+    u32 turnIdx = 0;
+
+    if (!skipCells && current.x == p->x && current.y == p->y) {
+        return 1;
+    }
+
+    // Follow the body for as many cells behind the head as the snake is long
+    for (u32 i = 0; i < s->length; i++) {
+        stepTrace(g, &current, &facing, &turnIdx);
+        if (isInWall(g, &current)) break;
 
-    for (int i = 0; i < g->numFoods; i++) {
-        freeFood(g->foods[i]);
+        if (i + 1 >= skipCells && current.x == p->x && current.y == p->y) {
+            return 1;
+        }
     }
 
-    free(g->foods);
-    free(g);
+    return 0;
 }
 
-void processGame(Game *g, u32 keysPressed) {
+void traceSnakeCells(Game *g, u32 *cells) {
+    Snake *s = &g->snake;
+    Point current = s->head;
+    u8 facing = getOpposite(s->facing);
+    u32 turnIdx = 0;
+
+    memset(cells, 0, OCCUPANCY_WORDS * sizeof(u32));
+
+    u32 cell = current.y * g->config.boardWidth + current.x;
+    cells[cell >> 5] |= 1u << (cell & 31);
+
+    for (u32 i = 0; i < s->length; i++) {
+        stepTrace(g, &current, &facing, &turnIdx);
+        if (isInWall(g, &current)) break;
+
+        cell = current.y * g->config.boardWidth + current.x;
+        cells[cell >> 5] |= 1u << (cell & 31);
+    }
+}
+
+/**
+ * Counts the turns of the reference engine's list that the walk of the body
+ * still reaches. The others are behind the tail.
+ */
+static u32 countTracedTurns(Game *g) {
+    Snake *s = &g->snake;
+    Point current = s->head;
+    u8 facing = getOpposite(s->facing);
+    u32 turnIdx = 0;
+
+    for (u32 i = 0; i < s->length; i++) {
+        stepTrace(g, &current, &facing, &turnIdx);
+        if (isInWall(g, &current)) break;
+    }
+
+    return turnIdx;
+}
+
+/**
+ * Pushes a turn onto the front of the reference engine's turn list. When
+ * the list is full the turns the body no longer reaches are dropped first,
+ * and the list only grows if that was not enough.
+ */
+static int pushReferenceTurn(Game *g, Turn *turn) {
+    ReferenceBody *r = &g->reference;
+
+    if (r->numTurns == r->capacity) {
+        r->numTurns = countTracedTurns(g);
+    }
+
+    if (r->numTurns == r->capacity) {
+        u32 capacity = r->capacity ? 2 * r->capacity : INITIAL_TURN_CAPACITY;
+        Turn *turns = arenaAlloc(&g->arena, capacity * sizeof(Turn));
+        if (!turns) return 0;
+
+        memcpy(turns, r->turns, r->numTurns * sizeof(Turn));
+        r->turns = turns;
+        r->capacity = capacity;
+    }
+
+    memmove(r->turns + 1, r->turns, r->numTurns * sizeof(Turn));
+    r->turns[0] = *turn;
+    r->numTurns++;
+
+    return 1;
+}
+
+int setGameEngine(Game *g, CollisionEngine engine) {
+    g->engine = engine;
+    if (engine != ENGINE_REFERENCE) {
+        return 1;
+    }
+
+    // Start the reference engine's turn list over from the ring buffer. It
+    // is sized up front, as pruning a half-copied list would drop turns the
+    // walk cannot reach yet.
+    Snake *s = &g->snake;
+    ReferenceBody *r = &g->reference;
+    if (r->capacity < s->numTurns) {
+        u32 capacity = r->capacity ? r->capacity : INITIAL_TURN_CAPACITY;
+        while (capacity < s->numTurns) capacity *= 2;
+
+        Turn *turns = arenaAlloc(&g->arena, capacity * sizeof(Turn));
+        if (!turns) return 0;
+
+        r->turns = turns;
+        r->capacity = capacity;
+    }
+
+    for (u32 i = 0; i < s->numTurns; i++) {
+        r->turns[i] = *getTurn(s, i);
+    }
+    r->numTurns = s->numTurns;
+
+    return 1;
+}
+
+void freeGame(Game *g) {
+    // Everything lives in the arena, including the game itself
+    void *memory = g->arena.firstBase;
+    releaseGame(g);
+    free(memory);
+}
+
+void releaseGame(Game *g) {
+    resetArena(&g->arena);
+}
+
+void processGame(Game *g, u32 input) {
     if (!g->paused) {
+        // Time the phases if a profile is being recorded
+        TickProfile *profile = PROFILE_TICKS ? tickProfile : NULL;
+        if (profile) beginTickPhases(profile);
+
 	   // Start by incrementing game cycle
     	g->currentCycle++;
 
-        // Remove expired foods
-        u16 newFoodCount = 0;
-        for (u16 i = 0; i < g->numFoods; i++) {
-            Food *f = g->foods[i];
-            if (g->currentCycle < f->deleteOnCycle) {
-                g->foods[newFoodCount++] = f;
-            } else {
-                freeFood(f);
-            }
-        }
-
-        g->numFoods = newFoodCount;
+        // Remove the foods expiring this cycle
+        expireFoods(g);
+        if (profile) endTickPhase(profile, PHASE_EXPIRY);
 
-        Snake *s = g->snake;
+        Snake *s = &g->snake;
 
         // Move the snake
         u16 speed = SNAKESPEED(g->score);
+        Point previousHead = s->head;
 
     	switch (s->facing) {
     	    case DOWN:
-    	        s->head->y += speed;
+    	        s->head.y += speed;
     			break;
     	    case RIGHT:
-    	        s->head->x += speed;
+    	        s->head.x += speed;
     			break;
     	    case UP:
-    	        s->head->y = s->head->y < speed ? speed : s->head->y;
-    	        s->head->y -= speed;
+    	        s->head.y = s->head.y < speed ? speed : s->head.y;
+    	        s->head.y -= speed;
     			break;
     	    case LEFT:
-    	        s->head->x = s->head->x < speed ? speed : s->head->x;
-    	        s->head->x -= speed;
+    	        s->head.x = s->head.x < speed ? speed : s->head.x;
+    	        s->head.x -= speed;
     			break;
     	}
 
+        // If either value is above MAX fix it
+        s->head.x = s->head.x >= g->config.boardWidth - 1 ? g->config.boardWidth - 1 : s->head.x;
+        s->head.y = s->head.y >= g->config.boardHeight - 1 ? g->config.boardHeight - 1 : s->head.y;
+
+        // The head covers every cell from the one after where it was up to
+        // where it is now, which is fewer than speed if it stopped at a wall
+        u16 moved = distBetween(&previousHead, &s->head);
+        if (profile) endTickPhase(profile, PHASE_MOVEMENT);
+
     	// If the snake needs to be grown, do that:
+        u32 previousLength = s->length;
         if ((g->currentCycle & 1) == 0) {
-        	s->length += speed;
+        	s->length += moved;
         	if (s->length > s->growToLength) s->length = s->growToLength;
         }
 
-        // If either value is above MAX fix it
-        s->head->x = s->head->x >= SNAKE_BOARD_WIDTH - 1 ? SNAKE_BOARD_WIDTH - 1 : s->head->x;
-        s->head->y = s->head->y >= SNAKE_BOARD_HEIGHT - 1 ? SNAKE_BOARD_HEIGHT - 1 : s->head->y;
+        // Retract the tail by however far the head moved without growing
+        for (u32 i = s->length - previousLength; i < moved; i++) {
+            advanceTail(g);
+        }
+        if (profile) endTickPhase(profile, PHASE_GROWTH);
 
         // Now check if we have collided into anything
-        s->dead = checkSelfCollision(s) || checkWallCollision(s);
+        s->dead = checkSelfCollision(g, moved) ? DEATH_SELF : (checkWallCollision(g) ? DEATH_WALL : ALIVE);
+        occupyHeadCells(g, moved);
+        if (profile) endTickPhase(profile, PHASE_COLLISION);
 
-        // Eat any food if necessary
-        for (u16 i = 0; i < g->numFoods; i++) {
-            Food *f = g->foods[i];
-            if (checkFoodCollision(s, f)) {
-                eatFood(f, g);
-            }
-        }
+        // Eat whatever the head went over
+        eatFoods(g, moved);
+        if (profile) endTickPhase(profile, PHASE_EATING);
 
         // Generate any new foods if we must
-        unsigned short missingFoods = FOODCOUNT(g->score) - g->numFoods;
-        while (missingFoods > 0) {
-            if (qran_range(1, FOOD_GENERATION_PROBABILITY_ONE_IN) == 1) {
-                g->foods[g->numFoods++] = createRandomFood(g);
-            }
-            missingFoods--;
-        }
+        spawnFoods(g);
+        if (profile) endTickPhase(profile, PHASE_SPAWNING);
 
-    	keysPressed |= ~(BUTTONS);
-
-        // Update snake facing
-        if (keysPressed & BUTTON_UP) {
-            turnSnake(s, UP);
-        } else if (keysPressed & BUTTON_RIGHT) {
-            turnSnake(s, RIGHT);
-        } else if (keysPressed & BUTTON_DOWN) {
-            turnSnake(s, DOWN);
-        } else if (keysPressed & BUTTON_LEFT) {
-            turnSnake(s, LEFT);
+        // Update snake facing. A turn there is no memory to store ends the game.
+        if (!steerSnake(g, input)) {
+            s->dead = DEATH_OUT_OF_MEMORY;
         }
+        if (profile) endTickPhase(profile, PHASE_INPUT);
 
     	// Update score once every 64 cycles
     	if ((g->currentCycle & 63) == 0) {
     		g->score += 2 * s->length;
     	}
+        if (profile) endTickPhase(profile, PHASE_SCORING);
     }
 
     // And we're done!
 }
 
+/**
+ * Gets how far ahead of the head a point is along the direction the snake is
+ * facing, or 0 if the point is not ahead of the head.
+ */
+static u32 getDistanceAhead(Snake *s, Point *p) {
+    switch (s->facing) {
+        case UP:
+            return p->x == s->head.x && p->y < s->head.y ? s->head.y - p->y : 0;
+        case DOWN:
+            return p->x == s->head.x && p->y > s->head.y ? p->y - s->head.y : 0;
+        case LEFT:
+            return p->y == s->head.y && p->x < s->head.x ? s->head.x - p->x : 0;
+        case RIGHT:
+            return p->y == s->head.y && p->x > s->head.x ? p->x - s->head.x : 0;
+    }
+
+    return 0;
+}
+
+u32 getNextEventCycle(Game *g, u32 untilCycle) {
+    Snake *s = &g->snake;
+    u32 next = g->currentCycle + 1;
+    u32 event = untilCycle;
+
+    // A food that went missing gets its spawn timer started on the next tick
+    u16 missingFoods = FOODCOUNT(g->score) - g->numFoods;
+    if (g->numSpawnTimers < missingFoods) {
+        return next;
+    }
+
+    // The score is updated once every 64 cycles
+    u32 scoring = (g->currentCycle | 63) + 1;
+    if (scoring < event) event = scoring;
+
+    for (u16 i = 0; i < g->numSpawnTimers; i++) {
+        if (g->spawnOnCycle[i] >= next && g->spawnOnCycle[i] < event) {
+            event = g->spawnOnCycle[i];
+        }
+    }
+
+    // Foods go when the wheel reaches their slot on or after their deleteOnCycle
+    u16 speed = SNAKESPEED(g->score);
+    for (u16 i = 0; i < g->numFoods; i++) {
+        Food *f = &g->foods[i];
+        u32 expiry = f->deleteOnCycle >= next ? f->deleteOnCycle :
+                     next + ((f->deleteOnCycle - next) & (FOOD_WHEEL_SLOTS - 1));
+        if (expiry < event) event = expiry;
+
+        // The head eats a food ahead of it on the tick it goes over it
+        u32 distance = getDistanceAhead(s, &f->location);
+        if (distance && g->currentCycle + (distance + speed - 1) / speed < event) {
+            event = g->currentCycle + (distance + speed - 1) / speed;
+        }
+    }
+
+    // The head dies on the first tick it reaches the edge of the board
+    u32 room = 0;
+    switch (s->facing) {
+        case UP:
+            room = s->head.y;
+            break;
+        case DOWN:
+            room = g->config.boardHeight - 1 - s->head.y;
+            break;
+        case LEFT:
+            room = s->head.x;
+            break;
+        case RIGHT:
+            room = g->config.boardWidth - 1 - s->head.x;
+            break;
+    }
+
+    u32 wall = g->currentCycle + (room + speed - 1) / speed;
+    if (wall < event) event = wall;
+
+    // Whatever of the body is ahead of the head now could still be there when
+    // the head goes over it, so the first such cell counts as a hit
+    Point p = s->head;
+    for (u32 cycle = next; cycle < event; cycle++) {
+        for (u16 step = 0; step < speed; step++) {
+            movePoint(&p, s->facing);
+
+            int hit = g->engine == ENGINE_SEGMENTS ? isOnSnake(s, &p, 1) :
+                      (g->engine == ENGINE_REFERENCE ? isOnSnakeTrace(g, &p, 1) : isOccupied(g, &p));
+            if (hit) {
+                event = cycle;
+                break;
+            }
+        }
+    }
+
+    return event < next ? next : event;
+}
+
+/**
+ * Moves a point several cells in a direction.
+ */
+static void movePointBy(Point *p, Direction d, u32 cells) {
+    switch (d) {
+        case UP:
+            p->y -= cells;
+            break;
+        case DOWN:
+            p->y += cells;
+            break;
+        case LEFT:
+            p->x -= cells;
+            break;
+        case RIGHT:
+            p->x += cells;
+            break;
+    }
+}
+
+/**
+ * Marks a straight run of cells as occupied or vacated in one go on the
+ * bitboard. The run starts at a point and goes on in a direction. Every
+ * cell of it must be in the other state, which holds for the cells quiet
+ * ticks go over. The bitboard then changes a word at a time along a row.
+ * Only the hash still takes a step per cell, as a run of Zobrist keys has
+ * no shortcut. The free cell index is left to replayFreeCells.
+ */
+static void markRun(Game *g, Point *start, Direction d, u32 cells, u8 occupied) {
+    if (cells == 0) return;
+
+    // Go over the run from its lowest cell up
+    Point first = *start;
+    if (d == LEFT) first.x -= cells - 1;
+    if (d == UP) first.y -= cells - 1;
+
+    u32 width = g->config.boardWidth;
+    u32 firstCell = first.y * width + first.x;
+    u32 stride = d == LEFT || d == RIGHT ? 1 : width;
+
+    for (u32 i = 0, cell = firstCell; i < cells; i++, cell += stride) {
+        g->hash ^= getZobristKey(ZOBRIST_BODY(cell));
+    }
+
+    if (stride == 1) {
+        // A row is one stretch of bits, so whole words are set or cleared
+        for (u32 cell = firstCell, end = firstCell + cells; cell < end; ) {
+            u32 bits = 32 - (cell & 31);
+            if (bits > end - cell) bits = end - cell;
+
+            u32 mask = (bits == 32 ? 0xFFFFFFFFu : (1u << bits) - 1) << (cell & 31);
+            if (occupied) {
+                g->occupied[cell >> 5] |= mask;
+            } else {
+                g->occupied[cell >> 5] &= ~mask;
+            }
+
+            cell += bits;
+        }
+    } else {
+        for (u32 i = 0, cell = firstCell; i < cells; i++, cell += stride) {
+            if (occupied) {
+                g->occupied[cell >> 5] |= 1u << (cell & 31);
+            } else {
+                g->occupied[cell >> 5] &= ~(1u << (cell & 31));
+            }
+        }
+    }
+}
+
+/**
+ * Makes the changes quiet ticks make to the free cell index, before the
+ * snake is moved. A draw from the index depends on the order of its cells,
+ * so this goes a tick at a time in processGame's order: the tail gives its
+ * cells back as it retracts, then the head takes the cells it covered,
+ * from the new head back. The tail is followed along the turns without
+ * touching them. None of these cells has a food on it on a quiet tick.
+ */
+static void replayFreeCells(Game *g, u32 ticks) {
+    Snake *s = &g->snake;
+    u16 speed = SNAKESPEED(g->score);
+    Direction back = getOpposite(s->facing);
+    u32 room = s->growToLength - s->length;
+
+    Point head = s->head;
+    Point tail = s->tail;
+    Direction tailFacing = s->tailFacing;
+    u32 hidden = s->hiddenLength;
+    u32 turns = s->numTurns;
+
+    for (u32 cycle = g->currentCycle + 1; cycle <= g->currentCycle + ticks; cycle++) {
+        // The snake grows on even cycles, and the tail stays put for that much
+        u32 growth = (cycle & 1) == 0 ? (speed < room ? speed : room) : 0;
+        room -= growth;
+
+        for (u32 i = growth; i < speed; i++) {
+            if (hidden > 0) {
+                hidden--;
+                continue;
+            }
+
+            returnFreeCell(g, &tail);
+            movePoint(&tail, tailFacing);
+
+            if (turns > 0) {
+                Turn *oldest = getTurn(s, turns - 1);
+                if (tail.x == oldest->location.x && tail.y == oldest->location.y) {
+                    tailFacing = turns > 1 ? getTurn(s, turns - 2)->previouslyFacing : s->facing;
+                    turns--;
+                }
+            }
+        }
+
+        movePointBy(&head, s->facing, speed);
+
+        Point p = head;
+        for (u16 i = 0; i < speed; i++) {
+            takeFreeCell(g, &p);
+            movePoint(&p, back);
+        }
+    }
+}
+
+/**
+ * Retracts the tail by several cells at once. It goes a straight stretch at
+ * a time, up to the oldest turn or as far as it has to, and follows the turn
+ * at the end of a stretch like advanceTail does.
+ */
+static void advanceTailBy(Game *g, u32 steps) {
+    Snake *s = &g->snake;
+
+    // Cells hidden in the wall go first
+    u32 hidden = steps < s->hiddenLength ? steps : s->hiddenLength;
+    s->hiddenLength -= hidden;
+    steps -= hidden;
+
+    while (steps > 0) {
+        Point *end = s->numTurns > 0 ? &getTurn(s, s->numTurns - 1)->location : &s->head;
+        u32 run = distBetween(&s->tail, end);
+        if (run == 0) break;
+        if (run > steps) run = steps;
+
+        markRun(g, &s->tail, s->tailFacing, run, 0);
+        movePointBy(&s->tail, s->tailFacing, run);
+        steps -= run;
+
+        if (s->numTurns > 0 && s->tail.x == end->x && s->tail.y == end->y) {
+            s->tailFacing = s->numTurns > 1 ? getTurn(s, s->numTurns - 2)->previouslyFacing : s->facing;
+            s->numTurns--;
+        }
+    }
+}
+
+/**
+ * Runs ticks that getNextEventCycle found to be quiet, all at once. They do
+ * exactly what processGame would do with no input, minus the checks that
+ * could only fail on an event. Only the free cell index depends on the
+ * order the cells change in, and replayFreeCells keeps that order. The
+ * rest does not, so the head moves its whole way, the snake grows by what
+ * it would over those ticks and the tail follows in a few straight
+ * stretches, with the bitboard updated a run at a time.
+ */
+static void skipQuietTicks(Game *g, u32 ticks) {
+    Snake *s = &g->snake;
+    replayFreeCells(g, ticks);
+
+    u32 cells = ticks * SNAKESPEED(g->score);
+
+    // The snake grows on every even cycle until it reaches its length
+    u32 growing = (g->currentCycle + ticks) / 2 - g->currentCycle / 2;
+    u32 growth = growing * SNAKESPEED(g->score);
+    if (growth > s->growToLength - s->length) growth = s->growToLength - s->length;
+
+    g->currentCycle += ticks;
+    s->length += growth;
+
+    Point next = s->head;
+    movePoint(&next, s->facing);
+    markRun(g, &next, s->facing, cells, 1);
+    movePointBy(&s->head, s->facing, cells);
+
+    advanceTailBy(g, cells - growth);
+}
+
+void fastForwardGame(Game *g, u32 untilCycle) {
+    while (!g->paused && !g->snake.dead && g->currentCycle < untilCycle) {
+        u32 event = getNextEventCycle(g, untilCycle);
+
+        // Jump over the quiet ticks, then play the event tick normally
+        skipQuietTicks(g, event - 1 - g->currentCycle);
+        processGame(g, INPUT_NONE);
+    }
+}
+
+u32 processGameN(Game *g, u32 *inputs, u32 n) {
+    // A paused game ignores its input, whatever it is
+    if (g->paused) return n;
+
+    u32 i = 0;
+    while (i < n && !g->snake.dead) {
+        if (inputs[i] != INPUT_NONE) {
+            processGame(g, inputs[i++]);
+            continue;
+        }
+
+        // Hand the whole run of ticks without input to the fast-forward
+        u32 run = 1;
+        while (i + run < n && inputs[i + run] == INPUT_NONE) {
+            run++;
+        }
+
+        u32 start = g->currentCycle;
+        fastForwardGame(g, start + run);
+        i += g->currentCycle - start;
+    }
+
+    return i;
+}
+
 void togglePause(Game *g) {
     g->paused = !g->paused;
 }
 
-Snake* createSnake() {
-    Snake *s = malloc(sizeof(Snake));
-    Point *head = malloc(sizeof(Point));
-    head->x = SNAKE_START_X;
-    head->y = SNAKE_START_Y;
-    s->head = head;
-    s->length = SNAKE_INITIAL_LENGTH;
-	s->growToLength = SNAKE_INITIAL_LENGTH;
-    s->facing = SNAKE_INITIAL_FACING;
-    s->numTurns = 0;
-    s->dead = 0;
+void expireFoods(Game *g) {
+    // The foods expiring this cycle are all in one wheel slot, which is
+    // empty on most cycles
+    u32 wheelSlot = g->currentCycle & (FOOD_WHEEL_SLOTS - 1);
+    if (!g->expiringOn[wheelSlot]) return;
+
+    // Remove them from the last food down, so which slot each food ends up
+    // in does not depend on the order the wheel slot lists them in
+    for (u16 i = g->numFoods; i-- > 0;) {
+        Food *f = &g->foods[i];
+        if ((f->deleteOnCycle & (FOOD_WHEEL_SLOTS - 1)) == wheelSlot && g->currentCycle >= f->deleteOnCycle) {
+            removeFood(g, i);
+        }
+    }
+}
 
-    s->turns = malloc(MAX_TURN_COUNT * sizeof(Turn*));
+u16 eatFoods(Game *g, u16 steps) {
+    u16 eaten = 0;
+
+    if (g->engine == ENGINE_REFERENCE) {
+        for (u16 i = 0; i < g->numFoods; i++) {
+            if (checkFoodCollision(g, &g->foods[i])) {
+                eatFood(&g->foods[i], g);
+                eaten++;
+            }
+        }
 
-    return s;
+        return eaten;
+    }
+
+    // Only the cells the head covered this tick can have a new food on them
+    Direction back = getOpposite(g->snake.facing);
+    Point p = g->snake.head;
+    for (u16 i = 0; i < steps; i++) {
+        Food *f = getFoodAt(g, &p);
+        if (f) {
+            eatFood(f, g);
+            eaten++;
+        }
+
+        movePoint(&p, back);
+    }
+
+    return eaten;
 }
 
-void freeSnake(Snake *s) {
-    free(s->head);
+void spawnFoods(Game *g) {
+    // Start a spawn timer for every newly missing food
+    u16 missingFoods = FOODCOUNT(g->score) - g->numFoods;
+    while (g->numSpawnTimers < missingFoods) {
+        g->spawnOnCycle[g->numSpawnTimers++] = g->currentCycle + sampleSpawnGap(g);
+    }
+
+    // Generate the foods whose timers fire now, retrying next cycle if there is no room
+    for (u16 i = 0; i < g->numSpawnTimers;) {
+        if (g->spawnOnCycle[i] != g->currentCycle) {
+            i++;
+        } else if (createRandomFood(g)) {
+            g->spawnOnCycle[i] = g->spawnOnCycle[--g->numSpawnTimers];
+        } else {
+            g->spawnOnCycle[i++] = g->currentCycle + 1 + sampleSpawnGap(g);
+        }
+    }
+}
 
-    for (int i = 0; i < s->numTurns; i++) {
-        freeTurn(s->turns[i]);
+int steerSnake(Game *g, u32 input) {
+    if (input & INPUT_UP) {
+        return turnSnake(g, UP);
+    } else if (input & INPUT_RIGHT) {
+        return turnSnake(g, RIGHT);
+    } else if (input & INPUT_DOWN) {
+        return turnSnake(g, DOWN);
+    } else if (input & INPUT_LEFT) {
+        return turnSnake(g, LEFT);
     }
 
-    free(s->turns);
+    return 1;
+}
 
-    free(s);
+void initSnake(Snake *s, Arena *a, GameConfig *config) {
+    s->head.x = config->startX;
+    s->head.y = config->startY;
+    s->length = config->initialLength;
+	s->growToLength = config->initialLength;
+    s->facing = config->initialFacing;
+    s->numTurns = 0;
+    s->newestTurn = 0;
+    s->turnCapacity = INITIAL_TURN_CAPACITY;
+    s->turns = arenaAlloc(a, INITIAL_TURN_CAPACITY * sizeof(Turn));
+    s->dead = ALIVE;
+
+    // Lay the initial body out behind the head. Whatever does not fit
+    // before the wall is kept as hidden length.
+    s->tail = s->head;
+    s->tailFacing = s->facing;
+    s->hiddenLength = s->length;
+
+    Direction back = getOpposite(s->facing);
+    Point next = s->tail;
+    while (s->hiddenLength > 0) {
+        movePoint(&next, back);
+        if (next.x <= 0 || next.x >= config->boardWidth - 1 ||
+            next.y <= 0 || next.y >= config->boardHeight - 1) {
+                break;
+        }
+
+        s->tail = next;
+        s->hiddenLength--;
+    }
 }
 
-void turnSnake(Snake *s, Direction facing) {
+int turnSnake(Game *g, Direction facing) {
+    Snake *s = &g->snake;
+
     if (s->facing != facing) {
         if (getOpposite(s->facing) != facing) {
-            // This is a valid turn! Move the turns by one.
-            if (s->numTurns == MAX_TURN_COUNT) {
-                freeTurn(s->turns[s->numTurns - 1]);
+            // This is a valid turn! Make room for it if the ring buffer is full.
+            if (s->numTurns == s->turnCapacity) {
+                Turn *turns = arenaAlloc(&g->arena, 2 * s->turnCapacity * sizeof(Turn));
+                if (!turns) return 0;
+
+                for (u32 i = 0; i < s->numTurns; i++) {
+                    turns[i] = *getTurn(s, i);
+                }
+
+                s->turns = turns;
+                s->newestTurn = 0;
+                s->turnCapacity *= 2;
             }
 
-            for (u16 i = s->numTurns; i > 0; i--) {
-                s->turns[i] = s->turns[i - 1];
-            }
+            // Step the ring buffer back by one slot
+            s->newestTurn = (s->newestTurn - 1) & (s->turnCapacity - 1);
 
-			Turn *t = malloc(sizeof(Turn));
-			t->location = malloc(sizeof(Point));
-            t->location->x = s->head->x;
-            t->location->y = s->head->y;
-			t->previouslyFacing = s->facing;
+            Turn *t = &s->turns[s->newestTurn];
+            t->location.x = s->head.x;
+            t->location.y = s->head.y;
+            t->previouslyFacing = s->facing;
 
-            s->turns[0] = t;
-            s->numTurns++;
+            // The reference engine keeps its own copy
+            if (g->engine == ENGINE_REFERENCE && !pushReferenceTurn(g, t)) {
+                s->newestTurn = (s->newestTurn + 1) & (s->turnCapacity - 1);
+                return 0;
+            }
 
-			if (s->numTurns > MAX_TURN_COUNT - 1) s->numTurns = MAX_TURN_COUNT - 1;
+            s->numTurns++;
 
+            g->hash ^= getZobristKey(ZOBRIST_FACING(s->facing)) ^ getZobristKey(ZOBRIST_FACING(facing));
             s->facing = facing;
         }
     }
+
+    return 1;
 }
 
-void freeTurn(Turn *t) {
-    free(t->location);
-    free(t);
+Turn* getTurn(Snake *s, u32 i) {
+    return &s->turns[(s->newestTurn + i) & (s->turnCapacity - 1)];
 }
 
-int checkSelfCollision(Snake *s) {
-	// Get the minX minY all that
-	if (s->numTurns < 3) {
-		return 0;
-	}
+void advanceTail(Game *g) {
+    Snake *s = &g->snake;
 
-	Point *head = s->head;
-	Point *lastTurn = s->turns[0]->location;
-
-	// Travel through the snake
-	Point current = *s->turns[0]->location;
-	Direction facing = getOpposite(s->facing);
-	u16 turnIdx = 0;
-	Turn *turn;
-	int removedDist = distBetween(head, lastTurn);
-	u16 remainingLength = (s->length > removedDist) ? s->length - removedDist : 0;
-
-	while (remainingLength > 0) {
-		// Check if this is a turn
-		if (turnIdx < s->numTurns) {
-			turn = s->turns[turnIdx];
-			if (current.x == turn->location->x && current.y == turn->location->y) {
-				facing = getOpposite(turn->previouslyFacing);
-				turnIdx++;
-			}
-		}
-
-		// Move the current ptr
-		switch (facing) {
-			case UP:
-				current.y--;
-				break;
-			case DOWN:
-				current.y++;
-				break;
-			case LEFT:
-				current.x--;
-				break;
-			case RIGHT:
-				current.x++;
-				break;
-		}
-
-		remainingLength--;
-
-		if (isBetween(&current, head, lastTurn)) {
-			return 1;
-		}
-
-		// If we flew out, break.
-		if (current.x <= 0 || current.x >= SNAKE_BOARD_WIDTH - 1 ||
-			current.y <= 0 || current.y >= SNAKE_BOARD_HEIGHT - 1) {
-				break;
-		}
-	}
+    // Cells hidden in the wall go first
+    if (s->hiddenLength > 0) {
+        s->hiddenLength--;
+        return;
+    }
+
+    vacateCell(g, &s->tail);
+    movePoint(&s->tail, s->tailFacing);
+
+    // If we reached the oldest turn, follow it and forget about it
+    if (s->numTurns > 0) {
+        Turn *oldest = getTurn(s, s->numTurns - 1);
+        if (s->tail.x == oldest->location.x && s->tail.y == oldest->location.y) {
+            s->tailFacing = s->numTurns > 1 ? getTurn(s, s->numTurns - 2)->previouslyFacing : s->facing;
+            s->numTurns--;
+        }
+    }
+}
+
+int checkSelfCollision(Game *g, u16 steps) {
+    Snake *s = &g->snake;
+    Direction back = getOpposite(s->facing);
+    Point p = s->head;
+
+    for (u16 i = 0; i < steps; i++) {
+        // The cells the head covered this tick are all on the head segment
+        // and are the first steps cells of the reference engine's walk
+        int hit = g->engine == ENGINE_SEGMENTS ? isOnSnake(s, &p, 1) :
+                  (g->engine == ENGINE_REFERENCE ? isOnSnakeTrace(g, &p, steps) : isOccupied(g, &p));
+        if (hit) {
+            return 1;
+        }
+
+        movePoint(&p, back);
+    }
 
     return 0;
 }
 
-int checkWallCollision(Snake *s) {
-    return  s->head->x <= 0 ||
-            s->head->x >= SNAKE_BOARD_WIDTH - 1 ||
-            s->head->y <= 0 ||
-            s->head->y >= SNAKE_BOARD_HEIGHT - 1;
+void occupyHeadCells(Game *g, u16 steps) {
+    Snake *s = &g->snake;
+    Direction back = getOpposite(s->facing);
+    Point p = s->head;
+
+    for (u16 i = 0; i < steps; i++) {
+        occupyCell(g, &p);
+        movePoint(&p, back);
+    }
 }
 
-Food* createRandomFood(Game *g) {
-    Food *f = malloc(sizeof(Food));
-	f->value = FOOD_LENGTH_INCREMENT;
-	f->deleteOnCycle = g->currentCycle + FOOD_DURATION;
+int isOnSnake(Snake *s, Point *p, u8 skipHead) {
+    // The body is the polyline from the head through every turn to the tail
+    Point *from = &s->head;
+    u32 turnIdx = 0;
 
-    u16 foodInSnake;
-	Point *p = malloc(sizeof(Point));
-    Snake *s = g->snake;
+    if (skipHead) {
+        // The head segment is straight, so only the segments behind the
+        // last turn can reach the head
+        if (s->numTurns == 0) return 0;
 
-    do {
-        p->x = qran_range((SNAKE_BOARD_WIDTH * 9) / 10, SNAKE_BOARD_WIDTH / 10);
-        p->y = qran_range((SNAKE_BOARD_HEIGHT * 9) / 10, SNAKE_BOARD_HEIGHT / 10);
+        from = &getTurn(s, 0)->location;
+        turnIdx = 1;
+    }
 
-        foodInSnake = 0;
+    for (; turnIdx < s->numTurns; turnIdx++) {
+        Point *to = &getTurn(s, turnIdx)->location;
+        if (isBetween(p, from, to)) {
+            return 1;
+        }
 
-        // Trace the snake to see if the food is in it
-        Point current = *s->head;
-    	Direction facing = getOpposite(s->facing);
-        u16 remainingLength = s->length;
+        from = to;
+    }
 
-    	u16 turnIdx = 0;
-    	Turn *turn;
+    return isBetween(p, from, &s->tail);
+}
 
-    	while (remainingLength > 0) {
-            // Check the spot
-            if (current.x == p->x && current.y == p->y) {
-                foodInSnake = 1;
-                break;
+u64 getZobristKey(u32 feature) {
+    // splitmix64 finalizer of the feature number
+    u64 x = (feature + 1) * 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+u64 computeGameHash(Game *g) {
+    u64 hash = getZobristKey(ZOBRIST_FACING(g->snake.facing));
+    u32 cells = g->config.boardWidth * g->config.boardHeight;
+
+    for (u32 cell = 0; cell < cells; cell++) {
+        if ((g->occupied[cell >> 5] >> (cell & 31)) & 1) hash ^= getZobristKey(ZOBRIST_BODY(cell));
+    }
+
+    for (u16 i = 0; i < g->numFoods; i++) {
+        hash ^= getZobristKey(ZOBRIST_FOOD(g->foods[i].location.y * g->config.boardWidth + g->foods[i].location.x));
+    }
+
+    return hash;
+}
+
+int isOccupied(Game *g, Point *p) {
+    u32 cell = p->y * g->config.boardWidth + p->x;
+    return (g->occupied[cell >> 5] >> (cell & 31)) & 1;
+}
+
+void occupyCell(Game *g, Point *p) {
+    if (isOccupied(g, p)) return;
+
+    u32 cell = p->y * g->config.boardWidth + p->x;
+    g->hash ^= getZobristKey(ZOBRIST_BODY(cell));
+    g->occupied[cell >> 5] |= 1u << (cell & 31);
+
+    // A cell with a food on it is already taken
+    if (!getFoodAt(g, p)) takeFreeCell(g, p);
+}
+
+void vacateCell(Game *g, Point *p) {
+    if (!isOccupied(g, p)) return;
+
+    u32 cell = p->y * g->config.boardWidth + p->x;
+    g->hash ^= getZobristKey(ZOBRIST_BODY(cell));
+    g->occupied[cell >> 5] &= ~(1u << (cell & 31));
+
+    if (!getFoodAt(g, p)) returnFreeCell(g, p);
+}
+
+void takeFreeCell(Game *g, Point *p) {
+    // Swap-remove the cell from the free cell index
+    u32 x = p->x - g->spawnX;
+    u32 y = p->y - g->spawnY;
+    if (x < g->spawnWidth && y < g->spawnHeight) {
+        u16 spawnCell = y * g->spawnWidth + x;
+        u16 slot = g->freeCellSlot[spawnCell];
+        if (slot != NO_FREE_CELL) {
+            u16 last = g->freeCells[--g->numFreeCells];
+            g->freeCells[slot] = last;
+            g->freeCellSlot[last] = slot;
+            g->freeCellSlot[spawnCell] = NO_FREE_CELL;
+        }
+    }
+}
+
+void returnFreeCell(Game *g, Point *p) {
+    // Put the cell back at the end of the free cell index
+    u32 x = p->x - g->spawnX;
+    u32 y = p->y - g->spawnY;
+    if (x < g->spawnWidth && y < g->spawnHeight) {
+        u16 spawnCell = y * g->spawnWidth + x;
+        if (g->freeCellSlot[spawnCell] == NO_FREE_CELL) {
+            g->freeCellSlot[spawnCell] = g->numFreeCells;
+            g->freeCells[g->numFreeCells++] = spawnCell;
+        }
+    }
+}
+
+void movePoint(Point *p, Direction d) {
+    switch (d) {
+        case UP:
+            p->y--;
+            break;
+        case DOWN:
+            p->y++;
+            break;
+        case LEFT:
+            p->x--;
+            break;
+        case RIGHT:
+            p->x++;
+            break;
+    }
+}
+
+int checkWallCollision(Game *g) {
+    Snake *s = &g->snake;
+    return  s->head.x <= 0 ||
+            s->head.x >= g->config.boardWidth - 1 ||
+            s->head.y <= 0 ||
+            s->head.y >= g->config.boardHeight - 1;
+}
+
+/**
+ * Checks a spawn cell drawn from the free cell index the reference engine's
+ * way. This is a check written for the reference engine, not one the
+ * original game made: it covers the cells of the engine's own walk of the
+ * body and the foods of the food array, without reading the occupancy
+ * bitboard or the food table, then counts what is left of the spawn
+ * margin. The cell must be among what is left, and the index must hold as
+ * many cells as there are.
+ */
+static int verifySpawnCell(Game *g, u16 spawnCell) {
+    u32 covered[OCCUPANCY_WORDS];
+    traceSnakeCells(g, covered);
+
+    for (u16 i = 0; i < g->numFoods; i++) {
+        u32 cell = g->foods[i].location.y * g->config.boardWidth + g->foods[i].location.x;
+        covered[cell >> 5] |= 1u << (cell & 31);
+    }
+
+    u32 numFree = 0;
+    int spawnCellFree = 0;
+    for (u16 y = 0; y < g->spawnHeight; y++) {
+        for (u16 x = 0; x < g->spawnWidth; x++) {
+            u32 cell = (g->spawnY + y) * g->config.boardWidth + g->spawnX + x;
+            if (!((covered[cell >> 5] >> (cell & 31)) & 1)) {
+                numFree++;
+                if (y * g->spawnWidth + x == spawnCell) spawnCellFree = 1;
             }
+        }
+    }
 
-    		// Check if this is a turn
-    		if (turnIdx < s->numTurns) {
-    			turn = s->turns[turnIdx];
-    			if (current.x == turn->location->x && current.y == turn->location->y) {
-    				facing = getOpposite(turn->previouslyFacing);
-    				turnIdx++;
-    			}
-    		}
-
-    		// Move the current ptr
-    		switch (facing) {
-    			case UP:
-    				current.y--;
-    				break;
-    			case DOWN:
-    				current.y++;
-    				break;
-    			case LEFT:
-    				current.x--;
-    				break;
-    			case RIGHT:
-    				current.x++;
-    				break;
-    		}
-
-    		remainingLength--;
-
-    		// If we flew out, break.
-    		if (current.x <= 0 || current.x >= SNAKE_BOARD_WIDTH - 1 ||
-    			current.y <= 0 || current.y >= SNAKE_BOARD_HEIGHT - 1) {
-    				break;
-    		}
-    	}
-    } while (foodInSnake);
+    return spawnCellFree && numFree == g->numFreeCells;
+}
+
+Food* createRandomFood(Game *g) {
+    if (g->numFreeCells == 0 || g->numFoods == MAX_FOOD_COUNT) {
+        return NULL;
+    }
+
+    // Draw a free cell uniformly from the spawn margin
+    u16 spawnCell = g->freeCells[qran_index(&g->rng, g->numFreeCells)];
+
+    // The reference engine checks the free cell index before using it
+    if (g->engine == ENGINE_REFERENCE && !verifySpawnCell(g, spawnCell)) {
+        return NULL;
+    }
+
+    Food *f = &g->foods[g->numFoods++];
+	f->value = g->config.foodIncrement;
+	f->deleteOnCycle = g->currentCycle + g->config.foodDuration;
+    f->location.x = g->spawnX + spawnCell % g->spawnWidth;
+    f->location.y = g->spawnY + spawnCell / g->spawnWidth;
+
+    // Hash the food's cell and keep other foods off it
+    u32 cell = f->location.y * g->config.boardWidth + f->location.x;
+    g->hash ^= getZobristKey(ZOBRIST_FOOD(cell));
+    takeFreeCell(g, &f->location);
 
-	f->location = p;
+    scheduleFood(g, g->numFoods - 1);
+    indexFood(g, g->numFoods - 1);
 
     return f;
 }
 
-void freeFood(Food *f) {
-    free(f->location);
-    free(f);
+u32 sampleSpawnGap(Game *g) {
+    u32 gap = 0;
+    u32 sample;
+
+    do {
+        u32 draw = qran_bits30(&g->rng);
+
+        // q^sample as 0.32 fixed point, starting from q^0 = 1
+        u64 chance = (u64) 1 << 32;
+        sample = 0;
+        for (int i = SPAWN_GAP_BITS - 1; i >= 0; i--) {
+            u64 next = (chance * g->spawnGapPowers[i]) >> 32;
+            if (draw < (next >> 2)) {
+                sample += 1u << i;
+                chance = next;
+            }
+        }
+
+        // A sample at the cap only says the gap is at least that long. The
+        // wait is memoryless, so the rest of it is a fresh sample.
+        gap += sample;
+    } while (sample == MAX_SPAWN_GAP_SAMPLE);
+
+    return gap;
 }
 
-int checkFoodCollision(Snake *s, Food *f) {
-	if (s->numTurns > 0) {
-		if (isBetween(f->location, s->head, s->turns[0]->location)) {
-			if (distBetween(f->location, s->head) <= s->length) {
-				return 1;
-			}
-		}
-	}
+void scheduleFood(Game *g, u16 i) {
+    u8 *slot = &g->expiringOn[g->foods[i].deleteOnCycle & (FOOD_WHEEL_SLOTS - 1)];
 
-	// Otherwise we just follow the snake towards its back facing direction
-	// until we run out of length.
-	Point current = *s->head;
-	Direction facing = getOpposite(s->facing);
-	u16 remainingLength = s->length;
-
-	while (remainingLength > 0) {
-		// Check if the food is here
-		if (current.x == f->location->x && current.y == f->location->y) {
-			return 1;
-		}
-
-		// Move the current ptr
-		switch (facing) {
-			case UP:
-				current.y--;
-				break;
-			case DOWN:
-				current.y++;
-				break;
-			case LEFT:
-				current.x--;
-				break;
-			case RIGHT:
-				current.x++;
-				break;
-		}
-
-		remainingLength--;
-
-		// If we flew out, break.
-		if (current.x <= 0 || current.x >= SNAKE_BOARD_WIDTH - 1 ||
-			current.y <= 0 || current.y >= SNAKE_BOARD_HEIGHT - 1) {
-				break;
-		}
-	}
+    g->previousExpiring[i] = 0;
+    g->nextExpiring[i] = *slot;
+    if (*slot) g->previousExpiring[*slot - 1] = i + 1;
+    *slot = i + 1;
+}
+
+void unscheduleFood(Game *g, u16 i) {
+    u8 previous = g->previousExpiring[i];
+    u8 next = g->nextExpiring[i];
+
+    if (previous) {
+        g->nextExpiring[previous - 1] = next;
+    } else {
+        g->expiringOn[g->foods[i].deleteOnCycle & (FOOD_WHEEL_SLOTS - 1)] = next;
+    }
+
+    if (next) g->previousExpiring[next - 1] = previous;
+}
+
+/**
+ * Hashes a cell to the food table entry its probe starts on.
+ */
+static u32 getFoodHome(u32 cell) {
+    return (cell * 2654435769u) >> (32 - FOOD_TABLE_BITS);
+}
+
+/**
+ * Gets the food table entry of a cell: the entry holding the cell, or the
+ * empty entry its probe stopped on if no food is on the cell. The table has
+ * more entries than there can be foods, so a probe always stops.
+ */
+static u32 findFoodEntry(Game *g, u32 cell) {
+    u32 entry = getFoodHome(cell);
+    while (g->foodCells[entry] != cell && g->foodCells[entry] != NO_FOOD_CELL) {
+        entry = (entry + 1) & (FOOD_TABLE_SIZE - 1);
+    }
+
+    return entry;
+}
+
+/**
+ * Empties an entry of the food table. The entries after it in its probe run
+ * are moved back into the hole when their own probe passes over it, so no
+ * probe stops short of its cell.
+ */
+static void clearFoodEntry(Game *g, u32 hole) {
+    u32 mask = FOOD_TABLE_SIZE - 1;
+
+    for (u32 entry = (hole + 1) & mask; g->foodCells[entry] != NO_FOOD_CELL; entry = (entry + 1) & mask) {
+        u32 home = getFoodHome(g->foodCells[entry]);
+        if (((entry - home) & mask) >= ((entry - hole) & mask)) {
+            g->foodCells[hole] = g->foodCells[entry];
+            g->foodSlots[hole] = g->foodSlots[entry];
+            hole = entry;
+        }
+    }
+
+    g->foodCells[hole] = NO_FOOD_CELL;
+}
+
+void indexFood(Game *g, u16 i) {
+    u32 cell = g->foods[i].location.y * g->config.boardWidth + g->foods[i].location.x;
+    u32 entry = findFoodEntry(g, cell);
+
+    g->foodCells[entry] = cell;
+    g->foodSlots[entry] = i;
+}
+
+void removeFood(Game *g, u16 i) {
+    Food *f = &g->foods[i];
+
+    unscheduleFood(g, i);
+    u32 cell = f->location.y * g->config.boardWidth + f->location.x;
+    clearFoodEntry(g, findFoodEntry(g, cell));
+    g->hash ^= getZobristKey(ZOBRIST_FOOD(cell));
+    if (!isOccupied(g, &f->location)) returnFreeCell(g, &f->location);
+
+    // Move the last food into the hole so the foods stay dense
+    u16 last = --g->numFoods;
+    if (i != last) {
+        unscheduleFood(g, last);
+        *f = g->foods[last];
+        scheduleFood(g, i);
+        indexFood(g, i);
+    }
+}
+
+Food* getFoodAt(Game *g, Point *p) {
+    u32 cell = p->y * g->config.boardWidth + p->x;
+    u32 entry = findFoodEntry(g, cell);
+
+    return g->foodCells[entry] == cell ? &g->foods[g->foodSlots[entry]] : NULL;
+}
+
+int checkFoodCollision(Game *g, Food *f) {
+    if (g->engine == ENGINE_SEGMENTS) {
+        return isOnSnake(&g->snake, &f->location, 0);
+    } else if (g->engine == ENGINE_REFERENCE) {
+        return isOnSnakeTrace(g, &f->location, 0);
+    }
 
-	return 0;
+    return isOccupied(g, &f->location);
 }
 
 void eatFood(Food *f, Game *g) {
-    // We set the food to expire now so
-    // that it will be deleted next cycle
+    // We set the food to expire next cycle so
+    // that it will be deleted then
     g->score += (f->deleteOnCycle - g->currentCycle) * 5;
 
-    f->deleteOnCycle = g->currentCycle;
+    u16 i = f - g->foods;
+    unscheduleFood(g, i);
+    f->deleteOnCycle = g->currentCycle + 1;
+    scheduleFood(g, i);
 
-	Snake *s = g->snake;
-	s->growToLength += f->value;
+	g->snake.growToLength += f->value;
 }
 
 int isBetween(Point *point, Point *p1, Point *p2) {
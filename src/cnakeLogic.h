@@ -7,14 +7,15 @@
 
 /**
  * The Point struct is used for keeping coordinates on the Snake board.
+ * Board coordinates always fit in a byte.
  */
 typedef struct
 {
 	/** X coordinate of the point */
-	u32 x;
+	u8 x;
 
 	/** Y coordinate of the point */
-    u32 y;
+    u8 y;
 } Point;
 
 /**
@@ -27,15 +28,68 @@ typedef enum {
 	RIGHT
 } Direction;
 
+/**
+ * The DeathCause enum tells what killed a snake. A snake that is still alive
+ * has the cause ALIVE, which is 0.
+ */
+typedef enum {
+	ALIVE,
+	DEATH_SELF,
+	DEATH_WALL,
+
+	/** The turn history could not grow to hold a turn, so the game cannot go on */
+	DEATH_OUT_OF_MEMORY,
+
+	/** Number of causes, not a cause itself */
+	NUM_DEATH_CAUSES
+} DeathCause;
+
+/**
+ * The Input enum holds the flags processGame takes as player input. Flags
+ * can be ORed together when several arrows were pressed during one tick.
+ */
+typedef enum {
+	INPUT_NONE = 0,
+	INPUT_UP = 1 << UP,
+	INPUT_DOWN = 1 << DOWN,
+	INPUT_LEFT = 1 << LEFT,
+	INPUT_RIGHT = 1 << RIGHT
+} Input;
+
+/**
+ * The CollisionEngine enum is used for choosing how a game answers
+ * collision and containment queries. They all give the same answers, they
+ * are kept side by side so that they can be benchmarked and tested against
+ * each other.
+ */
+typedef enum {
+	/** Single bit tests on the occupancy bitboard */
+	ENGINE_BITBOARD,
+
+	/** Tests against the segments between the snake's turns */
+	ENGINE_SEGMENTS,
+
+	/**
+	 * Keeps its own list of the snake's turns and walks the body cell by
+	 * cell from the head the way the original checks did, in code written
+	 * anew for this engine. It eats every food the walk finds and checks
+	 * every cell drawn from the free cell index against the walk before a
+	 * food spawns on it. It reads none of the tail, the turn ring buffer or
+	 * the occupancy bitboard. This is slow, it is kept as the oracle the
+	 * other engines are tested against.
+	 */
+	ENGINE_REFERENCE
+} CollisionEngine;
+
 /**
  * The Turn struct is used for keeping track of the turns the snake makes.
  */
 typedef struct {
 	/** The location of the turn */
-	Point *location;
+	Point location;
 
-	/** The direction the snake was facing before turning */
-	Direction previouslyFacing;
+	/** The direction the snake was facing before turning, as a Direction */
+	u8 previouslyFacing;
 } Turn;
 
 /**
@@ -44,52 +98,125 @@ typedef struct {
 typedef struct
 {
 	/** The position of the head of the snake */
-    Point *head;
+    Point head;
+
+	/** The position of the last cell of the snake that is on the board */
+	Point tail;
 
 	/** The length of the snake */
-	u16 length;
+	u32 length;
 
 	/**
 	 * The length the snake must grow to. This will be equal to length
  	 * unless the snake just ate a food and needs to grow.
 	 */
-	u16 growToLength;
+	u32 growToLength;
 
-	/** The direction the snake is currently facing */
-    Direction facing;
+	/**
+	 * Number of cells of the snake that are past the tail, inside the wall.
+	 * This is only nonzero while the initial body is longer than the space
+	 * behind the starting position.
+	 */
+	u32 hiddenLength;
 
-	/** Whether or not the snake is dead */
-	u8 dead;
+	/** Number of turns currently stored in the turn history */
+    u32 numTurns;
+
+	/** Index of the most recent turn in the turns ring buffer */
+	u32 newestTurn;
+
+	/** Number of turns the ring buffer can hold, always a power of two */
+	u32 turnCapacity;
 
-	/** Number of turns the snake has made */
-    u16 numTurns;
+	/** The direction the snake is currently facing, as a Direction */
+    u8 facing;
+
+	/** The direction the tail will move in when the snake moves, as a Direction */
+	u8 tailFacing;
+
+	/** Whether or not the snake is dead, as the DeathCause (ALIVE is 0) */
+	u8 dead;
 
-	/** Array of turn pointers to the turns the snake has made */
-	Turn **turns;
+	/**
+	 * Ring buffer of the turns still on the body of the snake, allocated
+	 * from the game's arena. Use getTurn to access it from the most recent
+	 * turn to the oldest one.
+	 */
+	Turn *turns;
 } Snake;
 
+/**
+ * The ReferenceBody struct is the reference engine's own record of the
+ * snake's body, kept the way the original game kept it: the turns in a
+ * plain array from the most recent one, with the body found by walking
+ * from the head for the snake's length. Turns the walk no longer reaches
+ * are dropped whenever the array fills up.
+ */
+typedef struct
+{
+	/** The turns, from the most recent one, allocated from the game's arena */
+	Turn *turns;
+
+	/** Number of turns in the array */
+	u32 numTurns;
+
+	/** Number of turns the array can hold */
+	u32 capacity;
+} ReferenceBody;
+
 /**
  * The Food struct is used for keeping track of the foods on the map.
  */
 typedef struct
 {
 	/** The location of the food on the board */
-    Point *location;
-
-	/** What game cycle the food must be deleted on (essentially expiry date) */
-    u32 deleteOnCycle;
+    Point location;
 
 	/** How much the snake will grow after eating this food */
     u16 value;
+
+	/** What game cycle the food must be deleted on (essentially expiry date) */
+    u32 deleteOnCycle;
 } Food;
 
 /**
  * The Game struct is used for keeping track of the entire game.
+ *
+ * A game is one flat value: the snake and the foods are stored inline.
+ * The only pointers are to the snake's turn ring buffer, which has no fixed
+ * size and lives in the game's arena at 3 bytes per turn still on the
+ * body, and to the free cell index, which the arena allocates at 4 bytes
+ * per cell of the game's own spawn margin (22116 bytes on the LARGE
+ * board). The game state comes first so that it shares as few cache lines
+ * as possible, the indices derived from it come after. The occupancy
+ * bitboard is sized for the largest board, so every game struct takes the
+ * same space whatever its config. With the default settings the byte
+ * budget is:
+ *
+ * - game state (config, snake, foods, score, cycle, rng, hash): 124 bytes on the GBA
+ * - food timer wheel: 266 bytes
+ * - food table: 48 bytes
+ * - food spawn timers: 88 bytes
+ * - spawn margin and free cell index pointers: 20 bytes on the GBA
+ * - occupancy bitboard: 1052 bytes
+ * - reference engine body: 12 bytes on the GBA
+ * - arena: 24 bytes on the GBA
+ *
+ * That is about 1.6 KB in all, which fits in L1 on the host. On the GBA a
+ * game made by createGame is on the heap in EWRAM; the game loop makes its
+ * game with initGame in a static block, which the linker puts in IWRAM,
+ * and the free cell index goes where the arena grows, in EWRAM.
  */
 typedef struct
 {
+	/** The settings the game was created with */
+	GameConfig config;
+
 	/** The snake present ingame */
-    Snake *snake;
+    Snake snake;
+
+	/** The foods on the map */
+	Food foods[MAX_FOOD_COUNT];
 
 	/** The current score */
 	u32 score;
@@ -97,38 +224,256 @@ typedef struct
 	/** The current cycle count (i.e. tick count) */
     u32 currentCycle;
 
-	/** Whether or not the game is paused */
-	u8 paused;
+	/** The game's own random number stream, which all food draws come from */
+	Rng rng;
+
+	/**
+	 * Zobrist hash of the snake's cells, the foods' cells and the facing,
+	 * XORed up to date whenever one of them changes.
+	 */
+	u64 hash;
 
 	/** Number of foods on the map */
     u16 numFoods;
 
-	/** Array of food pointers to the foods on the map */
-	Food **foods;
+	/**
+	 * Food timer wheel: slot (cycle % FOOD_WHEEL_SLOTS) holds one more than
+	 * the index of the first food to be deleted on that cycle, or 0.
+	 */
+	u8 expiringOn[FOOD_WHEEL_SLOTS];
+
+	/** The next food in the same wheel slot as each food, encoded like expiringOn */
+	u8 nextExpiring[MAX_FOOD_COUNT];
+
+	/** The previous food in the same wheel slot as each food, encoded like expiringOn */
+	u8 previousExpiring[MAX_FOOD_COUNT];
+
+	/**
+	 * Food table: an open-addressed hash of the cells the foods are on, with
+	 * linear probing from the hash of a cell. Each entry holds a cell
+	 * (y * config.boardWidth + x), or NO_FOOD_CELL if it is empty.
+	 */
+	u16 foodCells[FOOD_TABLE_SIZE];
+
+	/** Index in foods of the food on the cell of each entry of foodCells */
+	u8 foodSlots[FOOD_TABLE_SIZE];
+
+	/** The cycle each missing food will spawn on */
+	u32 spawnOnCycle[MAX_FOOD_COUNT];
+
+	/** Number of entries in spawnOnCycle, one per missing food */
+	u16 numSpawnTimers;
+
+	/**
+	 * Powers q^(2^i) of the chance q that a missing food does not spawn on a
+	 * cycle, as 0.32 fixed point numbers.
+	 */
+	u32 spawnGapPowers[SPAWN_GAP_BITS];
+
+	/** Whether or not the game is paused */
+	u8 paused;
+
+	/** The CollisionEngine answering the game's collision queries */
+	u8 engine;
+
+	/** X coordinate of the top left corner of the food spawn margin */
+	u16 spawnX;
+
+	/** Y coordinate of the top left corner of the food spawn margin */
+	u16 spawnY;
+
+	/** Width of the food spawn margin */
+	u16 spawnWidth;
+
+	/** Height of the food spawn margin */
+	u16 spawnHeight;
+
+	/** Number of cells in the food spawn margin with neither snake nor food on them */
+	u16 numFreeCells;
+
+	/**
+	 * Dense array of the free cells in the food spawn margin, i.e. the cells
+	 * with neither snake nor food on them, in its first numFreeCells
+	 * entries. Cells are numbered row by row inside the margin, starting
+	 * from (spawnX, spawnY). It has an entry for every cell of the margin
+	 * and is allocated from the game's arena.
+	 */
+	u16 *freeCells;
+
+	/**
+	 * Position of each spawn margin cell in freeCells, or NO_FREE_CELL if
+	 * the cell is not free. Allocated from the game's arena like freeCells.
+	 */
+	u16 *freeCellSlot;
+
+	/**
+	 * Occupancy bitboard of the snake: bit (y * config.boardWidth + x) is set
+	 * if the snake covers that cell. It is kept up to date as the head advances
+	 * and the tail retracts.
+	 */
+	u32 occupied[OCCUPANCY_WORDS];
+
+	/** The reference engine's record of the body, only kept up with that engine */
+	ReferenceBody reference;
+
+	/**
+	 * The arena the game lives in. Releasing the game resets it in one go.
+	 * This is bookkeeping for the memory the game is in rather than part
+	 * of the game, so it is kept last.
+	 */
+	Arena arena;
 } Game;
 
+/** Zobrist feature of the snake covering a cell */
+#define ZOBRIST_BODY(cell) (cell)
+
+/** Zobrist feature of a food lying on a cell */
+#define ZOBRIST_FOOD(cell) (MAX_BOARD_CELLS + (cell))
+
+/** Zobrist feature of the snake facing a Direction */
+#define ZOBRIST_FACING(direction) (2 * MAX_BOARD_CELLS + (direction))
+
+/** Marker in Game.foodCells for empty entries */
+#define NO_FOOD_CELL 0xFFFF
+
+/** Marker in Game.freeCellSlot for cells that are not free */
+#define NO_FREE_CELL 0xFFFF
+
+/**
+ * Size of the first block of the arena backing a game: the game itself and
+ * its initial turn ring buffer. The free cell index does not fit in it and
+ * is allocated from the block the arena grows into.
+ */
+#define GAME_ARENA_SIZE (ARENA_ALIGN(sizeof(Game)) + ARENA_ALIGN(INITIAL_TURN_CAPACITY * sizeof(Turn)))
+
+/**
+ * Checks that a game config fits the compile-time limits of the Game
+ * struct: the board has at most MAX_BOARD_CELLS cells and 255 cells per
+ * side, and the snake starts inside the walls.
+ *
+ * @param  config Pointer to the config to check.
+ * @return        1 if a game can be created from the config, 0 otherwise.
+ */
+int isValidConfig(GameConfig *config);
+
 /**
  * Creates a functional game struct in heap memory and returns a pointer to it.
  *
- * @return Pointer to the created game.
+ * The game is served from an arena of GAME_ARENA_SIZE bytes, which grows
+ * once for the free cell index when the game is created. Nothing else is
+ * allocated while the game runs unless the snake's turns outgrow their
+ * ring buffer.
+ *
+ * Games created with the same config and seed play out identically for the
+ * same input. The seed is the state of the game's qran stream, so a game
+ * seeded with the seed another game ended on continues that game's stream.
+ *
+ * @param  config Pointer to the settings of the game, which are copied.
+ * @param  seed   Seed of the game's random number stream.
+ * @return        Pointer to the created game, or NULL if the config is not
+ *                valid or there is no memory left for it.
+ */
+Game* createGame(GameConfig *config, u32 seed);
+
+/**
+ * Switches the collision engine of a game. The reference engine starts its
+ * own record of the body from the turn ring buffer, so this is best done
+ * right after creating the game, before there is anything to get wrong.
+ *
+ * @param  g      Pointer to the game to switch.
+ * @param  engine The CollisionEngine to switch to.
+ * @return        1 on success, 0 if there was no memory for the reference
+ *                engine's turns.
+ */
+int setGameEngine(Game *g, CollisionEngine engine);
+
+/**
+ * Creates a game in a memory block owned by the caller, which lets hosts
+ * keep a pool of blocks and reuse them for game after game.
+ *
+ * @param  memory Pointer to a block of GAME_ARENA_SIZE bytes, aligned for any type.
+ * @param  config Pointer to the settings of the game, which are copied.
+ * @param  seed   Seed of the game's random number stream.
+ * @return        Pointer to the created game, or NULL if the config is not
+ *                valid or there is no memory left for the free cell index.
  */
-Game* createGame();
+Game* initGame(void *memory, GameConfig *config, u32 seed);
 
 /**
- * Frees up a game from memory including its members.
+ * Frees up a game from memory by resetting its arena and giving the
+ * arena's memory block back.
  *
  * @param g Pointer to the game to free up.
  */
 void freeGame(Game *g);
 
 /**
- * Main tick loop of the game. Evaluates key presses, moves snake, runs
+ * Frees up the memory a game created with initGame grew into. The block the
+ * game was created in is left to the caller.
+ *
+ * @param g Pointer to the game to release.
+ */
+void releaseGame(Game *g);
+
+/**
+ * Main tick loop of the game. Evaluates input, moves snake, runs
  * collision checks, updates score, etc.
  *
- * @param g           Pointer to the game to process.
- * @param keysPressed Merged key press vector from delay time to process.
+ * When several directions are given only the first of up, right, down
+ * and left is taken.
+ *
+ * @param g     Pointer to the game to process.
+ * @param input Input flags to process, ORed together.
+ */
+void processGame(Game *g, u32 input);
+
+/**
+ * Finds the next tick that does more than move the snake straight ahead,
+ * assuming no input comes until then. Such a tick is an event: the head
+ * reaching a wall, the body or a food, a food expiring, a spawn timer
+ * starting or firing, or the score being updated.
+ *
+ * Everything but body hits is computed directly from the state. Body hits
+ * take one bit test per cell the head will go over.
+ *
+ * @param  g          Pointer to the game to look ahead in.
+ * @param  untilCycle The last cycle to look at.
+ * @return            Cycle of the next event, or untilCycle if there is none
+ *                    before it. Always after the current cycle.
  */
-void processGame(Game *g, u32 keysPressed);
+u32 getNextEventCycle(Game *g, u32 untilCycle);
+
+/**
+ * Advances a game to a later cycle with no input, leaving it in exactly the
+ * state that calling processGame with INPUT_NONE for every tick would.
+ *
+ * The ticks between two events are skipped together, without running
+ * any of their checks. The head and tail move a straight stretch at a time,
+ * the bitboard changes a word at a time along a row, and the free counts
+ * change once per stretch. What is left per cell is the bit test that
+ * looks for body hits ahead and the Zobrist key of each cell that changes.
+ * The game stops early if the snake dies, and does not move at all while
+ * it is paused.
+ *
+ * @param g          Pointer to the game to advance.
+ * @param untilCycle The cycle to stop on, i.e. the last tick without input.
+ */
+void fastForwardGame(Game *g, u32 untilCycle);
+
+/**
+ * Runs a game for several ticks from a script of per-tick inputs, stopping
+ * early on the tick the snake dies. This gives the same game as calling
+ * processGame once per input, but runs of ticks without input are
+ * fast-forwarded with fastForwardGame instead of played tick by tick.
+ *
+ * @param  g      Pointer to the game to process.
+ * @param  inputs Input flags of each tick, as processGame takes them.
+ * @param  n      Number of ticks to run.
+ * @return        Number of inputs used up: n, or fewer if the snake died.
+ *                A paused game uses up every input without changing, a
+ *                game whose snake is already dead uses up none.
+ */
+u32 processGameN(Game *g, u32 *inputs, u32 n);
 
 /**
  * Toggles the pause state of a game.
@@ -138,82 +483,331 @@ void processGame(Game *g, u32 keysPressed);
 void togglePause(Game *g);
 
 /**
- * Creates a functional snake struct in heap memory and returns a pointer to it.
+ * Deletes the foods whose deleteOnCycle has come, i.e. the foods in the
+ * timer wheel slot of the current cycle. They are deleted from the last
+ * one in foods down, so the foods left do not depend on the order of the
+ * wheel slot. This is the first step of a tick.
+ *
+ * @param g Pointer to the game to expire foods in.
+ */
+void expireFoods(Game *g);
+
+/**
+ * Eats the foods the head went over this tick, with one food table lookup
+ * per cell the head covered, whatever the number of foods. The reference
+ * engine eats every food on the body instead, in the order of their slots,
+ * like the original game did.
+ *
+ * @param  g     Pointer to the game whose snake moved.
+ * @param  steps Number of cells the head covered this tick, ending on the head.
+ * @return       Number of foods eaten.
+ */
+u16 eatFoods(Game *g, u16 steps);
+
+/**
+ * Starts a spawn timer for every missing food and generates the foods whose
+ * timers fire on the current cycle.
  *
- * @return Pointer to the created snake.
+ * @param g Pointer to the game to spawn foods in.
  */
-Snake* createSnake();
+void spawnFoods(Game *g);
 
 /**
- * Frees up a snake from memory including its members.
+ * Turns the snake according to a tick's input. When several directions are
+ * given only the first of up, right, down and left is taken.
  *
- * @param s Pointer to the snake to free up.
+ * @param  g     Pointer to the game whose snake to turn.
+ * @param  input Input flags to process, ORed together.
+ * @return       0 if the turn could not be stored, see turnSnake, 1 otherwise.
  */
-void freeSnake(Snake *s);
+int steerSnake(Game *g, u32 input);
 
 /**
- * Turns a snake: adds a turn to the Snake's turns vector and
+ * Sets up a snake at its starting position.
+ *
+ * @param s      Pointer to the snake to set up.
+ * @param a      Pointer to the arena to allocate the turn ring buffer from.
+ * @param config Pointer to the settings giving the start position and length.
+ */
+void initSnake(Snake *s, Arena *a, GameConfig *config);
+
+/**
+ * Turns a snake: pushes a turn onto the Snake's turn ring buffer and
  * updates the direction it's facing.
  *
- * @param s      [description]
- * @param facing [description]
+ * Turns are dropped from the ring buffer once the tail passes them, so it
+ * only holds the turns still on the body. When it is full it doubles in
+ * the game's arena, which keeps pushing amortised constant time without
+ * capping the number of turns. If the arena has no memory left to double
+ * into, the snake does not turn.
+ *
+ * @param  g      Pointer to the game whose snake to turn.
+ * @param  facing The direction the snake should face after the turn.
+ * @return        0 if the turn could not be stored, 1 if the snake turned
+ *                or the turn was not a valid one.
+ */
+int turnSnake(Game *g, Direction facing);
+
+/**
+ * Gets a turn from the snake's turn history.
+ *
+ * @param  s Pointer to the snake whose turn we want.
+ * @param  i Age of the turn: 0 is the most recent turn, numTurns - 1 the oldest.
+ * @return   Pointer to the turn.
  */
-void turnSnake(Snake *s, Direction facing);
+Turn* getTurn(Snake *s, u32 i);
 
 /**
- * Frees up a turn from memory including its members.
+ * Moves the tail of the snake forward by one cell, clearing the cell it
+ * leaves in the occupancy bitboard and dropping the oldest turn once the
+ * tail reaches it.
  *
- * @param t Pointer to the turn to free up.
+ * @param g Pointer to the game whose snake's tail we want to move.
  */
-void freeTurn(Turn *t);
+void advanceTail(Game *g);
 
 /**
- * Checks if the snake is colliding with itself.
+ * Checks if the snake ran into itself on any of the cells its head covered
+ * this tick. A snake faster than one cell per tick covers several, and
+ * running into the body on any of them is a collision.
  *
- * For the sake of performance this only checks if the part between
- * the snake's head and its last turn crosses any other part of the snake.
+ * This must be called after the head has moved and the tail has retracted
+ * but before the new head cells are marked on the occupancy bitboard. With
+ * the bitboard engine the check is then a bit test per cell, with the
+ * segment engine it tests each cell against every body segment behind the
+ * last turn, and with the reference engine it walks the whole body with
+ * isOnSnakeTrace.
  *
- * @param  s Pointer to the snake to check for self collisions.
- * @return   1 if collision exists, 0 otherwise.
+ * @param  g     Pointer to the game whose snake to check for self collisions.
+ * @param  steps Number of cells the head covered this tick, ending on the head.
+ * @return       1 if collision exists, 0 otherwise.
+ */
+int checkSelfCollision(Game *g, u16 steps);
+
+/**
+ * Marks the cells the head covered this tick as occupied.
+ *
+ * @param g     Pointer to the game whose snake moved.
+ * @param steps Number of cells the head covered this tick, ending on the head.
+ */
+void occupyHeadCells(Game *g, u16 steps);
+
+/**
+ * Checks if a point is on the snake by testing it against the axis-aligned
+ * segments between the head, each turn and the tail. This costs O(turns)
+ * regardless of the length of the snake.
+ *
+ * @param  s        Pointer to the snake to check.
+ * @param  p        Pointer to the point to check.
+ * @param  skipHead 1 to leave the head itself out of the check, 0 otherwise.
+ * @return          1 if the point is on the snake, 0 otherwise.
+ */
+int isOnSnake(Snake *s, Point *p, u8 skipHead);
+
+/**
+ * Gets the random key of a Zobrist feature. Keys are mixed from the feature
+ * number on the fly instead of being kept in a table, which would take
+ * 16 bytes per cell of the largest board.
+ *
+ * @param  feature The feature, from ZOBRIST_BODY, ZOBRIST_FOOD or ZOBRIST_FACING.
+ * @return         The feature's 64-bit key.
+ */
+u64 getZobristKey(u32 feature);
+
+/**
+ * Computes the Zobrist hash of a game from scratch by going over every cell
+ * of the board and every food. The game's hash field always equals this,
+ * but is kept up to date for a few XORs per tick instead.
+ *
+ * @param  g Pointer to the game to hash.
+ * @return   The game's Zobrist hash.
  */
-int checkSelfCollision(Snake *s);
+u64 computeGameHash(Game *g);
+
+/**
+ * Checks if a point is on the snake the way the reference engine does: by
+ * walking its own record of the body cell by cell from the head, turning
+ * back at every turn, for as many cells as the snake is long. Cells inside
+ * the wall are the part of the initial body that is still hidden, so the
+ * walk stops there. It costs O(length).
+ *
+ * This is a new implementation written for the reference engine, not the
+ * original checkSelfCollision and checkFoodCollision code. It walks the body
+ * the way those did, but over the engine's own turn list and with one walk
+ * for both checks, so it is only as good an oracle as cnakeDiff's
+ * comparisons against the other engines make it.
+ *
+ * @param  g         Pointer to the game whose snake to check.
+ * @param  p         Pointer to the point to check.
+ * @param  skipCells Number of cells at the head end of the walk, starting
+ *                   with the head itself, to leave out of the check.
+ * @return           1 if the point is on the snake, 0 otherwise.
+ */
+int isOnSnakeTrace(Game *g, Point *p, u32 skipCells);
+
+/**
+ * Marks every cell the reference engine's walk of the body covers. Like
+ * isOnSnakeTrace it is a new implementation for the reference engine, which
+ * the original game had no counterpart of.
+ *
+ * @param g     Pointer to the game whose snake to walk.
+ * @param cells Pointer to OCCUPANCY_WORDS words, laid out like the
+ *              occupancy bitboard, to set the covered cells' bits in. The
+ *              other bits are cleared.
+ */
+void traceSnakeCells(Game *g, u32 *cells);
+
+/**
+ * Checks if a cell of the board is covered by the snake.
+ *
+ * @param  g Pointer to the game to check the occupancy bitboard of.
+ * @param  p Pointer to the point to check.
+ * @return   1 if the cell is occupied, 0 otherwise.
+ */
+int isOccupied(Game *g, Point *p);
+
+/**
+ * Marks a cell of the board as covered by the snake and takes it out of the
+ * free cell index.
+ *
+ * @param g Pointer to the game to update the occupancy bitboard of.
+ * @param p Pointer to the point to mark.
+ */
+void occupyCell(Game *g, Point *p);
+
+/**
+ * Marks a cell of the board as no longer covered by the snake and gives it
+ * back to the free cell index unless a food is on it.
+ *
+ * @param g Pointer to the game to update the occupancy bitboard of.
+ * @param p Pointer to the point to clear.
+ */
+void vacateCell(Game *g, Point *p);
+
+/**
+ * Swap-removes a cell from the free cell index if it is inside the food
+ * spawn margin and still free.
+ *
+ * @param g Pointer to the game to update the free cell index of.
+ * @param p Pointer to the point to take.
+ */
+void takeFreeCell(Game *g, Point *p);
+
+/**
+ * Puts a cell back at the end of the free cell index if it is inside the
+ * food spawn margin and not already there.
+ *
+ * @param g Pointer to the game to update the free cell index of.
+ * @param p Pointer to the point to give back.
+ */
+void returnFreeCell(Game *g, Point *p);
+
+/**
+ * Moves a point by one cell in the given direction.
+ *
+ * @param p Pointer to the point to move.
+ * @param d The direction to move the point in.
+ */
+void movePoint(Point *p, Direction d);
 
 /**
  * Checks if the snake is colliding with a wall.
  *
- * @param  s Pointer to the snake to check for wall collisions.
+ * @param  g Pointer to the game whose snake to check for wall collisions.
  * @return   1 if collision exists, 0 otherwise.
  */
-int checkWallCollision(Snake *s);
+int checkWallCollision(Game *g);
 
 /**
- * Creates a functional food struct in heap memory and returns a pointer to it.
- * The food will be placed at a random point on the map that is not occupied
- * by the snake.
+ * Adds a food to the end of the game's food array and returns a pointer to it.
+ * The food will be placed at a uniformly random point inside the spawn
+ * margin that is not occupied by the snake or another food.
+ *
+ * The point is drawn from the free cell index in constant time, however
+ * full the board is. Which cell a draw gives depends on the order the
+ * index is in, so every path that changes the index has to change it in
+ * the same order. The reference engine draws the same cell, then checks
+ * it with its own walk of the body and the food array: the cell must be
+ * free and the index must hold as many cells as the walk leaves free.
  *
  * @param g Pointer to the game to add this food to.
- * @return  Pointer to the created food.
+ * @return  Pointer to the created food, or NULL if there is no free cell
+ *          or the food array is full. With the reference engine also NULL
+ *          if its walk finds the free cell index wrong.
  */
 Food* createRandomFood(Game *g);
 
 /**
- * Frees up a food from memory including its members.
+ * Samples how many cycles a missing food waits before it spawns.
  *
- * @param f Pointer to the food to free up.
+ * Each cycle a missing food spawns with chance FOOD_SPAWN_CHANCE(oneIn) /
+ * 32768, where oneIn is the config's foodGenerationOneIn, so the wait is
+ * geometrically distributed. It is sampled by inversion from a 30-bit draw:
+ * the wait is the largest k with draw < q^k, found one bit at a time from
+ * the highest power in spawnGapPowers. A draw that reaches
+ * MAX_SPAWN_GAP_SAMPLE is followed by another one, added on top, so very
+ * rare spawns are not cut short.
+ *
+ * @param  g Pointer to the game to sample for.
+ * @return   Number of cycles without a spawn before the spawning cycle.
  */
-void freeFood(Food *f);
+u32 sampleSpawnGap(Game *g);
 
 /**
- * Checks if the snake is colliding with a given food.
+ * Links a food into the timer wheel slot of its deleteOnCycle.
  *
- * For the sake of performance this only checks if the food is between
- * the snake's head and its last turn.
+ * @param g Pointer to the game the food is in.
+ * @param i Index of the food in the game's foods.
+ */
+void scheduleFood(Game *g, u16 i);
+
+/**
+ * Unlinks a food from its timer wheel slot. This must be called before the
+ * food's deleteOnCycle changes.
+ *
+ * @param g Pointer to the game the food is in.
+ * @param i Index of the food in the game's foods.
+ */
+void unscheduleFood(Game *g, u16 i);
+
+/**
+ * Adds a food to the food table under the cell it is on.
+ *
+ * @param g Pointer to the game the food is in.
+ * @param i Index of the food in the game's foods.
+ */
+void indexFood(Game *g, u16 i);
+
+/**
+ * Deletes a food from the game. The last food is moved into its place, so
+ * the order of the foods is not kept.
+ *
+ * @param g Pointer to the game the food is in.
+ * @param i Index of the food in the game's foods.
+ */
+void removeFood(Game *g, u16 i);
+
+/**
+ * Finds the food on a cell of the board with a lookup in the food table.
+ *
+ * @param  g Pointer to the game to look the food up in.
+ * @param  p Pointer to the point to look at.
+ * @return   Pointer to the food on that cell, or NULL if there is none.
+ */
+Food* getFoodAt(Game *g, Point *p);
+
+/**
+ * Checks if the snake is colliding with a given food, i.e. if the food is
+ * anywhere on the snake. This asks the occupancy bitboard, the body
+ * segments or the cell by cell walk depending on the game's collision engine.
+ * The reference engine eats every food this finds, the others only look
+ * under the head.
  *
- * @param  s Pointer to the snake to check for collisions.
+ * @param  g Pointer to the game whose snake to check for collisions.
  * @param  f Pointer to the food to check if the snake is colliding with.
  * @return   1 if collision exists, 0 otherwise.
  */
-int checkFoodCollision(Snake *s, Food *f);
+int checkFoodCollision(Game *g, Food *f);
 
 /**
  * Makes the snake eat a food: adds the length increase, the score, and
@@ -0,0 +1,172 @@
+#include "cnake.h"
+
+static const char *policyNames[NUM_PLAYER_POLICIES] = { "random", "wall-follower", "greedy", "cycle" };
+
+/**
+ * Checks if the head would hit a wall or the body on a cell.
+ */
+static int isBlocked(Game *g, Point *p) {
+    return  p->x == 0 || p->x >= g->config.boardWidth - 1 ||
+            p->y == 0 || p->y >= g->config.boardHeight - 1 ||
+            isOccupied(g, p);
+}
+
+/**
+ * Gets the direction a quarter turn clockwise from another one.
+ */
+static Direction getClockwise(Direction d) {
+    switch (d) {
+        case UP:
+            return RIGHT;
+        case RIGHT:
+            return DOWN;
+        case DOWN:
+            return LEFT;
+        case LEFT:
+            return UP;
+    }
+
+    return UP;
+}
+
+static u32 chooseRandomInput(Rng *r) {
+    if (qran_range(r, 0, PLAYER_PRESS_ONE_IN) != 0) {
+        return INPUT_NONE;
+    }
+
+    return 1u << qran_range(r, 0, 4);
+}
+
+static u32 chooseWallFollowerInput(Game *g, Point *from) {
+    Direction facing = g->snake.facing;
+    Direction sides[2] = { getClockwise(facing), getOpposite(getClockwise(facing)) };
+
+    Point ahead = *from;
+    movePoint(&ahead, facing);
+    if (!isBlocked(g, &ahead)) {
+        return INPUT_NONE;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        Point p = *from;
+        movePoint(&p, sides[i]);
+        if (!isBlocked(g, &p)) {
+            return 1u << sides[i];
+        }
+    }
+
+    return INPUT_NONE;
+}
+
+static u32 chooseGreedyInput(Game *g, Rng *r, Point *from) {
+    Snake *s = &g->snake;
+
+    Direction options[3] = { s->facing, UP, DOWN };
+    if (s->facing == UP || s->facing == DOWN) {
+        options[1] = LEFT;
+        options[2] = RIGHT;
+    }
+
+    int wander = qran_range(r, 0, PLAYER_WANDER_ONE_IN) == 0;
+    int best = -1;
+    u32 bestCost = 0;
+
+    for (int i = 0; i < 3; i++) {
+        Point p = *from;
+        movePoint(&p, options[i]);
+        if (isBlocked(g, &p)) {
+            continue;
+        }
+
+        u32 cost = wander ? (u32) qran(r) : 0xFFFF;
+        if (!wander) {
+            for (u16 j = 0; j < g->numFoods; j++) {
+                Point *f = &g->foods[j].location;
+                u32 dist = (p.x > f->x ? p.x - f->x : f->x - p.x) + (p.y > f->y ? p.y - f->y : f->y - p.y);
+                if (dist < cost) cost = dist;
+            }
+        }
+
+        if (best < 0 || cost < bestCost) {
+            best = i;
+            bestCost = cost;
+        }
+    }
+
+    if (best <= 0) return INPUT_NONE;
+    return 1u << options[best];
+}
+
+/**
+ * Gets the direction the cycle goes in from a cell, counted from the top left
+ * cell inside the walls. Rows are swept back and forth, leaving the first
+ * column for the way back up from the last row, so there must be an even
+ * number of rows.
+ */
+static Direction getCycleDirection(u32 x, u32 y, u32 width, u32 height) {
+    if (x == 0) {
+        return y == 0 ? RIGHT : UP;
+    } else if ((y & 1) == 0) {
+        return x == width - 1 ? DOWN : RIGHT;
+    } else if (y == height - 1) {
+        return LEFT;
+    }
+
+    return x == 1 ? DOWN : LEFT;
+}
+
+static u32 chooseCycleInput(Game *g, Point *from) {
+    u32 width = g->config.boardWidth - 2;
+    u32 height = g->config.boardHeight - 2;
+    u32 x = (u32) from->x - 1;
+    u32 y = (u32) from->y - 1;
+
+    if (x >= width || y >= height || width < 2 || height < 2 || (width & height & 1)) {
+        return chooseWallFollowerInput(g, from);
+    }
+
+    // With an odd number of rows the cycle sweeps the columns instead
+    Direction d;
+    if ((height & 1) == 0) {
+        d = getCycleDirection(x, y, width, height);
+    } else {
+        static const Direction transposed[4] = { LEFT, RIGHT, UP, DOWN };
+        d = transposed[getCycleDirection(y, x, height, width)];
+    }
+
+    // Until the snake gets onto the cycle it cannot always turn the way it goes
+    if (d == getOpposite(g->snake.facing)) {
+        return chooseWallFollowerInput(g, from);
+    }
+
+    return d == g->snake.facing ? INPUT_NONE : 1u << d;
+}
+
+u32 choosePlayerInput(Game *g, Rng *r, PlayerPolicy policy) {
+    Point from = g->snake.head;
+    movePoint(&from, g->snake.facing);
+
+    switch (policy) {
+        case PLAYER_RANDOM:
+            return chooseRandomInput(r);
+        case PLAYER_WALL_FOLLOWER:
+            return chooseWallFollowerInput(g, &from);
+        case PLAYER_GREEDY:
+            return chooseGreedyInput(g, r, &from);
+        case PLAYER_CYCLE:
+            return chooseCycleInput(g, &from);
+        default:
+            break;
+    }
+
+    return INPUT_NONE;
+}
+
+void seedPlayer(Rng *r, u32 seed) {
+    sqran(r, seed);
+    qran_split(r);
+}
+
+const char* getPolicyName(PlayerPolicy policy) {
+    return policy < NUM_PLAYER_POLICIES ? policyNames[policy] : "?";
+}
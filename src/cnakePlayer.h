@@ -0,0 +1,69 @@
+/**
+ * @file
+ * @author Cem Gokmen
+ * @date 2 Apr 2017
+ * @brief This file contains the cnake scripted player functions.
+ */
+
+/** Chance out of 64 that the greedy player makes a random move instead of heading for food */
+#define PLAYER_WANDER_ONE_IN 64
+
+/** Chance out of 8 that the random player presses a random arrow on a tick */
+#define PLAYER_PRESS_ONE_IN 8
+
+/**
+ * The PlayerPolicy enum is used for choosing how a scripted player picks
+ * its input.
+ */
+typedef enum {
+	/** Now and then presses a random arrow, whether or not it is safe */
+	PLAYER_RANDOM,
+
+	/** Goes straight until it is about to hit something, then turns right, or left if it must */
+	PLAYER_WALL_FOLLOWER,
+
+	/** Heads for the closest food along a safe direction, and now and then wanders off */
+	PLAYER_GREEDY,
+
+	/**
+	 * Follows a cycle through every cell inside the walls, so the snake
+	 * only dies once it fills the board. Boards with an odd number of rows
+	 * and columns inside the walls have no such cycle, there it follows
+	 * the walls instead.
+	 */
+	PLAYER_CYCLE,
+
+	/** Number of policies, not a policy itself */
+	NUM_PLAYER_POLICIES
+} PlayerPolicy;
+
+/**
+ * Seeds the random number stream of a scripted player for the game created
+ * with a given seed. The player draws from the block of the sequence right
+ * after the game's own, so the two never share numbers.
+ *
+ * @param r    Pointer to the player's stream.
+ * @param seed Seed the player's game was created with.
+ */
+void seedPlayer(Rng *r, u32 seed);
+
+/**
+ * Picks the input of a scripted player for a game's next tick.
+ *
+ * Input only turns the snake after the tick's move, so the players plan
+ * from the cell the head is about to move to.
+ *
+ * @param  g      Pointer to the game to play.
+ * @param  r      Pointer to the player's own random number stream.
+ * @param  policy The PlayerPolicy to play by.
+ * @return        Input flags to pass to processGame.
+ */
+u32 choosePlayerInput(Game *g, Rng *r, PlayerPolicy policy);
+
+/**
+ * Gets the name of a scripted player policy, for printing results.
+ *
+ * @param  policy The PlayerPolicy to name.
+ * @return        The policy's name in lower case.
+ */
+const char* getPolicyName(PlayerPolicy policy);
@@ -0,0 +1,77 @@
+#include "cnake.h"
+#include <stddef.h>
+#include <string.h>
+
+TickProfile *tickProfile = NULL;
+
+static const char *phaseNames[NUM_TICK_PHASES] = {
+    "expiry", "movement", "growth", "collision", "eating", "spawning", "input", "scoring"
+};
+
+void initTickProfile(TickProfile *p, u32 (*readClock)(void), u32 clockHz) {
+    p->readClock = readClock;
+    p->clockHz = clockHz;
+    p->lastMark = 0;
+    resetTickProfile(p);
+
+    // Back to back readings only differ by what a reading costs
+    p->clockOverhead = 0xFFFFFFFF;
+    for (u32 i = 0; i < PROFILE_CALIBRATION_READS; i++) {
+        u32 start = readClock();
+        u32 elapsed = readClock() - start;
+        if (elapsed < p->clockOverhead) p->clockOverhead = elapsed;
+    }
+}
+
+void resetTickProfile(TickProfile *p) {
+    memset(p->phases, 0, sizeof(p->phases));
+}
+
+void beginTickPhases(TickProfile *p) {
+    p->lastMark = p->readClock();
+}
+
+void endTickPhase(TickProfile *p, TickPhase phase) {
+    u32 now = p->readClock();
+    u32 elapsed = now - p->lastMark;
+    addPhaseSample(&p->phases[phase], elapsed > p->clockOverhead ? elapsed - p->clockOverhead : 0);
+    p->lastMark = now;
+}
+
+void addPhaseSample(PhaseHistogram *h, u32 elapsed) {
+    // The bucket is the position of the highest set bit
+    u32 bucket = 0;
+    while (elapsed >> (bucket + 1)) {
+        bucket++;
+    }
+
+    h->counts[bucket]++;
+    h->samples++;
+    h->total += elapsed;
+    if (elapsed > h->max) h->max = elapsed;
+}
+
+u32 getPhasePercentile(PhaseHistogram *h, u32 percent) {
+    if (!h->samples) {
+        return 0;
+    }
+
+    // Find the bucket holding the sample at the percentile's rank
+    u64 rank = ((u64) h->samples * percent + 99) / 100;
+    if (rank == 0) rank = 1;
+
+    u64 seen = 0;
+    for (u32 bucket = 0; bucket < PROFILE_BUCKETS; bucket++) {
+        seen += h->counts[bucket];
+        if (seen >= rank) {
+            u32 bound = bucket < 31 ? (2u << bucket) - 1 : 0xFFFFFFFF;
+            return bound < h->max ? bound : h->max;
+        }
+    }
+
+    return h->max;
+}
+
+const char* getPhaseName(TickPhase phase) {
+    return phase < NUM_TICK_PHASES ? phaseNames[phase] : "?";
+}
@@ -0,0 +1,161 @@
+/**
+ * @file
+ * @author Cem Gokmen
+ * @date 2 Apr 2017
+ * @brief This file contains the cnake tick profiler functions.
+ */
+
+/**
+ * Number of buckets in a phase histogram. Bucket b counts the samples that
+ * took from 2^b to 2^(b+1) - 1 clock ticks, bucket 0 also counts the ones
+ * that took no time at all.
+ */
+#define PROFILE_BUCKETS 32
+
+/** Number of back to back clock readings the cost of a reading is measured from */
+#define PROFILE_CALIBRATION_READS 64
+
+/**
+ * The TickPhase enum is used for naming the phases of processGame that the
+ * profiler times, in the order they run.
+ */
+typedef enum {
+	/** Removing the foods expiring this cycle */
+	PHASE_EXPIRY,
+
+	/** Moving the head and stopping it at the edge of the board */
+	PHASE_MOVEMENT,
+
+	/** Growing the snake and retracting the tail */
+	PHASE_GROWTH,
+
+	/** Checking the head against the body and the walls */
+	PHASE_COLLISION,
+
+	/** Eating the food under the head */
+	PHASE_EATING,
+
+	/** Spawning the foods that are due */
+	PHASE_SPAWNING,
+
+	/** Turning the snake as the input asks */
+	PHASE_INPUT,
+
+	/** Adding to the score */
+	PHASE_SCORING,
+
+	/** Number of phases, not a phase itself */
+	NUM_TICK_PHASES
+} TickPhase;
+
+/**
+ * The PhaseHistogram struct holds how long one phase took on every tick
+ * it was timed on.
+ */
+typedef struct
+{
+	/** Number of samples in each bucket */
+	u32 counts[PROFILE_BUCKETS];
+
+	/** Number of samples taken */
+	u32 samples;
+
+	/** Sum of all samples, in clock ticks */
+	u64 total;
+
+	/** Longest sample, in clock ticks */
+	u32 max;
+} PhaseHistogram;
+
+/**
+ * The TickProfile struct holds the clock the profiler reads and a histogram
+ * for every phase of processGame.
+ */
+typedef struct
+{
+	/**
+	 * Reads a free running clock. Only differences between readings are
+	 * used, so the clock may start anywhere and wrap around.
+	 */
+	u32 (*readClock)(void);
+
+	/** Number of times the clock ticks in a second */
+	u32 clockHz;
+
+	/** What reading the clock costs, taken off every sample */
+	u32 clockOverhead;
+
+	/** Clock reading at the end of the last phase timed */
+	u32 lastMark;
+
+	/** One histogram per TickPhase */
+	PhaseHistogram phases[NUM_TICK_PHASES];
+} TickProfile;
+
+/**
+ * The profile processGame records into, or NULL not to profile. There is a
+ * single profile for the whole program, so games played on other threads
+ * must not be profiled at the same time. Ticks skipped by fastForwardGame
+ * and ticks stepped by processGameBatch are not recorded.
+ */
+extern TickProfile *tickProfile;
+
+/**
+ * Sets up a profile with empty histograms, and measures what reading its
+ * clock costs.
+ *
+ * @param p         Pointer to the profile to set up.
+ * @param readClock Function that reads the clock to time phases with.
+ * @param clockHz   Number of times that clock ticks in a second.
+ */
+void initTickProfile(TickProfile *p, u32 (*readClock)(void), u32 clockHz);
+
+/**
+ * Empties every histogram of a profile, keeping its clock.
+ *
+ * @param p Pointer to the profile to empty.
+ */
+void resetTickProfile(TickProfile *p);
+
+/**
+ * Starts timing a tick: the first phase timed after this starts now.
+ *
+ * @param p Pointer to the profile to record into.
+ */
+void beginTickPhases(TickProfile *p);
+
+/**
+ * Ends a phase, adding the time since the previous phase ended, or since
+ * beginTickPhases, to its histogram less the cost of reading the clock. The
+ * next phase starts now.
+ *
+ * @param p     Pointer to the profile to record into.
+ * @param phase The TickPhase that just ended.
+ */
+void endTickPhase(TickProfile *p, TickPhase phase);
+
+/**
+ * Adds a sample to a histogram.
+ *
+ * @param h       Pointer to the histogram to add to.
+ * @param elapsed How long the sample took, in clock ticks.
+ */
+void addPhaseSample(PhaseHistogram *h, u32 elapsed);
+
+/**
+ * Estimates a percentile of a histogram as the upper bound of the bucket it
+ * falls in, so the estimate is at most twice the real value.
+ *
+ * @param  h       Pointer to the histogram to read.
+ * @param  percent The percentile to estimate, from 0 to 100.
+ * @return         The estimate in clock ticks, or 0 if there are no samples.
+ */
+u32 getPhasePercentile(PhaseHistogram *h, u32 percent);
+
+/**
+ * Gets the name of a phase, for dumping profiles.
+ *
+ * @param  phase The TickPhase to name.
+ * @return       The phase's name in lower case.
+ */
+const char* getPhaseName(TickPhase phase);
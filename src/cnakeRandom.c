@@ -0,0 +1,52 @@
+#include "cnake.h"
+
+// Random Number Generator
+// Courtesy of Tonc
+u32 sqran(Rng *r, u32 seed) {
+    u32 old= r->seed;
+    r->seed= seed;
+    return old;
+}
+
+int qran(Rng *r) {
+    r->seed= QRAN_MULTIPLIER*r->seed+QRAN_INCREMENT;
+    return (r->seed>>16) & 0x7FFF;
+}
+
+int qran_range(Rng *r, int min, int max) {
+	return (qran(r)*(max-min)>>15)+min;
+}
+
+u32 qran_bits30(Rng *r) {
+	u32 high = qran(r);
+	return (high << 15) | qran(r);
+}
+
+int qran_index(Rng *r, int n) {
+	return (int) (((u64) qran_bits30(r) * n) >> 30);
+}
+
+void qran_jump(Rng *r, u32 n) {
+	// Compose the step x -> a * x + c with itself by repeated squaring
+	u32 multiplier = 1, increment = 0;
+	u32 stepMultiplier = QRAN_MULTIPLIER, stepIncrement = QRAN_INCREMENT;
+
+	while (n) {
+		if (n & 1) {
+			multiplier *= stepMultiplier;
+			increment = increment * stepMultiplier + stepIncrement;
+		}
+
+		stepIncrement *= stepMultiplier + 1;
+		stepMultiplier *= stepMultiplier;
+		n >>= 1;
+	}
+
+	r->seed = multiplier * r->seed + increment;
+}
+
+Rng qran_split(Rng *r) {
+	Rng split = *r;
+	qran_jump(r, QRAN_SPLIT_STRIDE);
+	return split;
+}
@@ -0,0 +1,96 @@
+/**
+ * @file
+ * @author Cem Gokmen
+ * @date 2 Apr 2017
+ * @brief This file contains the cnake random number generator functions.
+ */
+
+/** Multiplier of the qran linear congruential generator */
+#define QRAN_MULTIPLIER 1664525u
+
+/** Increment of the qran linear congruential generator */
+#define QRAN_INCREMENT 1013904223u
+
+/**
+ * Number of steps qran_split moves a parent stream forward by. Split streams
+ * never overlap as long as none of them takes more than this many steps,
+ * and up to 2^32 / QRAN_SPLIT_STRIDE of them fit into the generator's period.
+ */
+#define QRAN_SPLIT_STRIDE (1u << 20)
+
+/**
+ * The Rng struct holds the state of one random number stream. Every game
+ * owns its own, so games never share or race on a stream.
+ */
+typedef struct
+{
+	/** The current state of the linear congruential generator */
+	u32 seed;
+} Rng;
+
+/**
+ * Sets the seed of a random number stream.
+ *
+ * @param  r    Pointer to the stream to seed.
+ * @param  seed new seed.
+ * @return      the previous seed.
+ */
+u32 sqran(Rng *r, u32 seed);
+
+/**
+ * Generates a pseudo-random number between 0 and 0x7FFF, inclusive.
+ *
+ * @param  r Pointer to the stream to draw from.
+ * @return   random number.
+ */
+int qran(Rng *r);
+
+/**
+ * Generates a pseudo-random number between min and max, inclusive.
+ *
+ * I totally snatched this function from tonc.
+ *
+ * @param  r   Pointer to the stream to draw from.
+ * @param  min bottom end of range.
+ * @param  max top end of range.
+ * @return     random number in the given range.
+ */
+int qran_range(Rng *r, int min, int max);
+
+/**
+ * Generates 30 pseudo-random bits by combining two qran draws.
+ *
+ * @param  r Pointer to the stream to draw from.
+ * @return   random number between 0 and 2^30 - 1, inclusive.
+ */
+u32 qran_bits30(Rng *r);
+
+/**
+ * Generates a pseudo-random index between 0 and n - 1, inclusive.
+ *
+ * This combines two qran draws so that large ranges stay uniform.
+ *
+ * @param  r Pointer to the stream to draw from.
+ * @param  n size of the range.
+ * @return   random index in the given range.
+ */
+int qran_index(Rng *r, int n);
+
+/**
+ * Moves a stream forward as if qran had been called n times, in
+ * logarithmic time.
+ *
+ * @param r Pointer to the stream to move.
+ * @param n Number of steps to skip.
+ */
+void qran_jump(Rng *r, u32 n);
+
+/**
+ * Splits a new stream off a stream. The new stream starts where the parent
+ * is, and the parent skips QRAN_SPLIT_STRIDE steps ahead, so streams split
+ * one after the other draw from disjoint blocks of the same sequence.
+ *
+ * @param  r Pointer to the parent stream.
+ * @return   The split off stream.
+ */
+Rng qran_split(Rng *r);
@@ -0,0 +1,179 @@
+#include "cnake.h"
+#include <stddef.h>
+
+/**
+ * Appends an unsigned LEB128 varint to a replay, 7 bits per byte from the
+ * lowest ones.
+ */
+static void writeVarint(ReplayRecorder *r, u64 value) {
+    do {
+        u8 byte = value & 0x7F;
+        value >>= 7;
+
+        if (r->size == r->capacity) {
+            r->overflowed = 1;
+            return;
+        }
+
+        r->data[r->size++] = value ? byte | 0x80 : byte;
+    } while (value);
+}
+
+/**
+ * Reads an unsigned LEB128 varint from a replay. Running out of replay or
+ * into a varint longer than 64 bits marks the replay broken and gives 0.
+ */
+static u64 readVarint(ReplayReader *r) {
+    u64 value = 0;
+
+    for (u32 shift = 0; shift < 64; shift += 7) {
+        if (r->position == r->size) {
+            break;
+        }
+
+        u8 byte = r->data[r->position++];
+        value |= (u64) (byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+
+    r->broken = 1;
+    return 0;
+}
+
+/**
+ * Writes a record: the cycles since the last record and the facing after it.
+ */
+static void writeRecord(ReplayRecorder *r, u32 cycle, u8 facing) {
+    writeVarint(r, (u64) (cycle - r->lastCycle) << 2 | facing);
+    r->lastCycle = cycle;
+}
+
+/**
+ * Reads the next record into the reader. A record that leaves the facing
+ * unchanged is the end record. A turn must come on a later cycle than the
+ * previous record and cannot reverse the snake, so one that does not, or
+ * a replay that runs out, ends the replay at the previous record.
+ */
+static void readRecord(ReplayReader *r) {
+    u8 facing = r->nextFacing;
+    u64 record = readVarint(r);
+    u64 cycles = record >> 2;
+    u8 nextFacing = record & 3;
+
+    if (nextFacing != facing && (cycles == 0 || nextFacing == getOpposite(facing))) {
+        r->broken = 1;
+    }
+
+    if (cycles > 0xFFFFFFFF - r->nextCycle) {
+        r->broken = 1;
+    }
+
+    if (r->broken) {
+        r->ended = 1;
+        return;
+    }
+
+    r->nextCycle += cycles;
+    r->nextFacing = nextFacing;
+    r->ended = nextFacing == facing;
+}
+
+void initReplayRecorder(ReplayRecorder *r, u8 *buffer, u32 capacity, GameConfig *config, u32 seed) {
+    r->data = buffer;
+    r->capacity = capacity;
+    r->size = 0;
+    r->overflowed = 0;
+    r->facing = config->initialFacing;
+    r->lastCycle = 0;
+
+    writeVarint(r, REPLAY_VERSION);
+    writeVarint(r, seed);
+    writeVarint(r, config->boardWidth);
+    writeVarint(r, config->boardHeight);
+    writeVarint(r, config->drawScale);
+    writeVarint(r, config->startX);
+    writeVarint(r, config->startY);
+    writeVarint(r, config->initialFacing);
+    writeVarint(r, config->initialLength);
+    writeVarint(r, config->foodDuration);
+    writeVarint(r, config->foodIncrement);
+    writeVarint(r, config->foodGenerationOneIn);
+}
+
+void recordReplayTick(ReplayRecorder *r, Game *g) {
+    if (g->snake.facing != r->facing) {
+        writeRecord(r, g->currentCycle, g->snake.facing);
+        r->facing = g->snake.facing;
+    }
+}
+
+u32 finishReplay(ReplayRecorder *r, Game *g) {
+    writeRecord(r, g->currentCycle, r->facing);
+
+    return r->overflowed ? 0 : r->size;
+}
+
+int initReplayReader(ReplayReader *r, u8 *data, u32 size) {
+    r->data = data;
+    r->size = size;
+    r->position = 0;
+    r->broken = 0;
+
+    if (readVarint(r) != REPLAY_VERSION) {
+        return 0;
+    }
+
+    r->seed = readVarint(r);
+    r->config.boardWidth = readVarint(r);
+    r->config.boardHeight = readVarint(r);
+    r->config.drawScale = readVarint(r);
+    r->config.startX = readVarint(r);
+    r->config.startY = readVarint(r);
+    r->config.initialFacing = readVarint(r);
+    r->config.initialLength = readVarint(r);
+    r->config.foodDuration = readVarint(r);
+    r->config.foodIncrement = readVarint(r);
+    r->config.foodGenerationOneIn = readVarint(r);
+    if (r->broken) {
+        return 0;
+    }
+
+    r->nextCycle = 0;
+    r->nextFacing = r->config.initialFacing;
+    readRecord(r);
+
+    return isValidConfig(&r->config);
+}
+
+u32 readReplayInput(ReplayReader *r, Game *g) {
+    if (r->ended || g->currentCycle + 1 != r->nextCycle) {
+        return INPUT_NONE;
+    }
+
+    // Steering toward the recorded facing turns the snake on the same tick
+    u32 input = 1u << r->nextFacing;
+    readRecord(r);
+
+    return input;
+}
+
+Game* playReplay(void *memory, u8 *data, u32 size) {
+    ReplayReader r;
+    if (!initReplayReader(&r, data, size)) {
+        return NULL;
+    }
+
+    Game *g = initGame(memory, &r.config, r.seed);
+    if (!g) {
+        return NULL;
+    }
+
+    while (!r.ended && !g->snake.dead) {
+        fastForwardGame(g, r.nextCycle - 1);
+        processGame(g, readReplayInput(&r, g));
+    }
+
+    fastForwardGame(g, r.nextCycle);
+
+    return g;
+}
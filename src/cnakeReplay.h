@@ -0,0 +1,155 @@
+/**
+ * @file
+ * @author Cem Gokmen
+ * @date 2 Apr 2017
+ * @brief This file contains the cnake replay recording and playback functions.
+ */
+
+/**
+ * Version of the replay format, written as the first byte of every replay.
+ *
+ * A replay holds, as LEB128 varints:
+ *
+ * - the version, then the game's seed
+ * - the config: boardWidth, boardHeight, drawScale, startX, startY,
+ *   initialFacing, initialLength, foodDuration, foodIncrement and
+ *   foodGenerationOneIn
+ * - one record per tick the snake's facing changed on, as the number of
+ *   cycles since the previous record shifted left by 2, ORed with the new
+ *   facing
+ * - an end record, encoded the same way but with the facing unchanged,
+ *   giving the last cycle of the game
+ *
+ * The rest of the game follows from the seed, so nothing else is stored.
+ */
+#define REPLAY_VERSION 1
+
+/**
+ * The ReplayRecorder struct is used for writing the replay of a game into a
+ * buffer owned by the caller while the game is played.
+ */
+typedef struct
+{
+	/** The buffer the replay is written to */
+	u8 *data;
+
+	/** Size of the buffer in bytes */
+	u32 capacity;
+
+	/** Number of bytes written so far */
+	u32 size;
+
+	/** Whether the replay outgrew the buffer, in which case it is useless */
+	u8 overflowed;
+
+	/** The facing of the snake as of the last record */
+	u8 facing;
+
+	/** The cycle of the last record */
+	u32 lastCycle;
+} ReplayRecorder;
+
+/**
+ * The ReplayReader struct is used for feeding the input of a replay back
+ * into a game, tick by tick.
+ */
+typedef struct
+{
+	/** The replay being read */
+	u8 *data;
+
+	/** Size of the replay in bytes */
+	u32 size;
+
+	/** Position of the next record in the replay */
+	u32 position;
+
+	/** The seed of the replayed game */
+	u32 seed;
+
+	/** The config of the replayed game */
+	GameConfig config;
+
+	/** Cycle the next record is on */
+	u32 nextCycle;
+
+	/** The facing the next record turns the snake to, as a Direction */
+	u8 nextFacing;
+
+	/** Whether the next record is the end record */
+	u8 ended;
+
+	/**
+	 * Whether the replay ran out before its end record or holds a record no
+	 * game can have written. Reading stops at the last good record, as if
+	 * it were followed by the end record.
+	 */
+	u8 broken;
+} ReplayReader;
+
+/**
+ * Starts recording a game by writing the replay header.
+ *
+ * @param r        Pointer to the recorder to set up.
+ * @param buffer   Pointer to the buffer to write the replay to.
+ * @param capacity Size of the buffer in bytes.
+ * @param config   Pointer to the settings the game was created with.
+ * @param seed     Seed the game was created with.
+ */
+void initReplayRecorder(ReplayRecorder *r, u8 *buffer, u32 capacity, GameConfig *config, u32 seed);
+
+/**
+ * Records a tick of a game. This must be called after every processGame
+ * call, as it only notices the snake turning by comparing its facing with
+ * the facing of the last record.
+ *
+ * @param r Pointer to the recorder of the game.
+ * @param g Pointer to the game that just ticked.
+ */
+void recordReplayTick(ReplayRecorder *r, Game *g);
+
+/**
+ * Ends a replay with the game's current cycle.
+ *
+ * @param  r Pointer to the recorder of the game.
+ * @param  g Pointer to the recorded game.
+ * @return   Size of the replay in bytes, or 0 if it did not fit the buffer.
+ */
+u32 finishReplay(ReplayRecorder *r, Game *g);
+
+/**
+ * Starts reading a replay: reads its header into the reader's seed and
+ * config, and the first record.
+ *
+ * @param  r    Pointer to the reader to set up.
+ * @param  data Pointer to the replay.
+ * @param  size Size of the replay in bytes.
+ * @return      1 if the header is a valid replay header, 0 otherwise.
+ *              A replay whose records are broken still has a valid header.
+ */
+int initReplayReader(ReplayReader *r, u8 *data, u32 size);
+
+/**
+ * Gets the input that reproduces the next tick of a replayed game and
+ * moves on to the following record once it is used up.
+ *
+ * @param  r Pointer to the reader of the replay.
+ * @param  g Pointer to the game created from the reader's config and seed.
+ * @return   Input flags to pass to processGame for the game's next tick.
+ */
+u32 readReplayInput(ReplayReader *r, Game *g);
+
+/**
+ * Plays a whole replay into a memory block owned by the caller. The stretches
+ * between two turns are fast-forwarded, so playing a replay back takes
+ * a fraction of the time the game took to play. Playback stops when the
+ * snake dies, and a broken replay is played up to its last good record.
+ *
+ * @param  memory Pointer to a block of GAME_ARENA_SIZE bytes, aligned for any type.
+ * @param  data   Pointer to the replay.
+ * @param  size   Size of the replay in bytes.
+ * @return        Pointer to the game as of the end of the replay, or NULL
+ *                if the replay is not valid or there is no memory left for
+ *                the game.
+ */
+Game* playReplay(void *memory, u8 *data, u32 size);
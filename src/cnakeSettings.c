@@ -1,20 +1,63 @@
-#include "myLib.h"
+#include "cnake.h"
 
-u32 SNAKE_BOARD_WIDTH;
-u32 SNAKE_BOARD_HEIGHT;
-u32 DRAW_SCALE;
-u32 SNAKE_INITIAL_LENGTH;
+GameConfig getMapConfig(u16 mapSize) {
+    GameConfig config;
 
-void setMapSize(u16 mapSize) {
     if (!mapSize) {
-        SNAKE_BOARD_WIDTH = SMALL_BOARD_WIDTH;
-        SNAKE_BOARD_HEIGHT = SMALL_BOARD_HEIGHT;
-        DRAW_SCALE = SMALL_DRAW_SCALE;
-        SNAKE_INITIAL_LENGTH = SMALL_INITIAL_LENGTH;
+        config.boardWidth = SMALL_BOARD_WIDTH;
+        config.boardHeight = SMALL_BOARD_HEIGHT;
+        config.drawScale = SMALL_DRAW_SCALE;
+        config.initialLength = SMALL_INITIAL_LENGTH;
     } else {
-        SNAKE_BOARD_WIDTH = LARGE_BOARD_WIDTH;
-        SNAKE_BOARD_HEIGHT = LARGE_BOARD_HEIGHT;
-        DRAW_SCALE = LARGE_DRAW_SCALE;
-        SNAKE_INITIAL_LENGTH = LARGE_INITIAL_LENGTH;
+        config.boardWidth = LARGE_BOARD_WIDTH;
+        config.boardHeight = LARGE_BOARD_HEIGHT;
+        config.drawScale = LARGE_DRAW_SCALE;
+        config.initialLength = LARGE_INITIAL_LENGTH;
     }
+
+    config.startX = SNAKE_START_X;
+    config.startY = SNAKE_START_Y;
+    config.initialFacing = SNAKE_INITIAL_FACING;
+    config.foodDuration = FOOD_DURATION;
+    config.foodIncrement = FOOD_LENGTH_INCREMENT;
+    config.foodGenerationOneIn = FOOD_GENERATION_PROBABILITY_ONE_IN;
+
+    return config;
+}
+
+/**
+ * Parses a decimal number of up to 3 digits, moving the text past it.
+ * Returns a value no board side can have if there are no digits.
+ */
+static u32 parseBoardSide(const char **text) {
+    u32 value = 0;
+    u32 digits = 0;
+
+    while (**text >= '0' && **text <= '9' && digits < 4) {
+        value = value * 10 + (**text - '0');
+        digits++;
+        (*text)++;
+    }
+
+    return digits && digits <= 3 ? value : 0xFFFF;
+}
+
+int parseBoardConfig(const char *text, GameConfig *config) {
+    u32 width = parseBoardSide(&text);
+    if (*text++ != 'x') {
+        return 0;
+    }
+
+    u32 height = parseBoardSide(&text);
+    if (*text || width > 255 || height > 255) {
+        return 0;
+    }
+
+    *config = getMapConfig(1);
+    config->boardWidth = width;
+    config->boardHeight = height;
+    config->startX = width / 2;
+    config->startY = height / 2;
+
+    return isValidConfig(config);
 }
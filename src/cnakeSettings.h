@@ -30,53 +30,62 @@
 #define LARGE_INITIAL_LENGTH 30
 
 /**
- * Width of the snake board.
+ * The GameConfig struct holds the settings of a single game. Every game
+ * carries its own copy, so games of different sizes can run side by side.
  *
- * This number is fetched from the SMALL and LARGE macros according to
- * the map size choice of the player.
- *
- * It is very important that no matter the player's choice,
- * this number multiplied by DRAW_SCALE equals 240.
- */
-extern u32 SNAKE_BOARD_WIDTH;
-
-/**
- * Height of the snake board.
- *
- * This number is fetched from the SMALL and LARGE macros according to
- * the map size choice of the player.
- *
- * It is very important that no matter the player's choice,
- * this number multiplied by DRAW_SCALE is less than 160.
- *
- * The remaining space on the screen will be used for the scoreboard.
- */
-extern u32 SNAKE_BOARD_HEIGHT;
-
-/**
- * Scale factor for drawing the snake board on the screen.
- *
- * This number is fetched from the SMALL and LARGE macros according to
- * the map size choice of the player.
- *
- * It is important to set this number correctly so that the drawing fills
- * up the screen but does not overflow. All ingame coordinates are multiplied
- * by this number for drawing.
- */
-extern u32 DRAW_SCALE;
-
-/**
- * Initial length of the snake.
- *
- * This number is fetched from the SMALL and LARGE macros according to
- * the map size choice of the player.
- *
- * Shorter snake lengths make more sense for smaller boards.
+ * The SMALL and LARGE macros and the defaults below are only used to build
+ * the configs the GBA offers, see getMapConfig.
  */
-extern u32 SNAKE_INITIAL_LENGTH;
-
-/** Starting height of the scoreboard */
-#define SCORE_BOX_Y SNAKE_BOARD_HEIGHT * DRAW_SCALE
+typedef struct
+{
+	/**
+	 * Width of the snake board, walls included. The board may not have more
+	 * than MAX_BOARD_CELLS cells.
+	 *
+	 * On the GBA it is very important that this number multiplied by
+	 * drawScale equals 240.
+	 */
+	u16 boardWidth;
+
+	/**
+	 * Height of the snake board, walls included.
+	 *
+	 * On the GBA it is very important that this number multiplied by
+	 * drawScale is less than 160. The remaining space on the screen will
+	 * be used for the scoreboard.
+	 */
+	u16 boardHeight;
+
+	/**
+	 * Scale factor for drawing the snake board on the screen. All ingame
+	 * coordinates are multiplied by this number for drawing.
+	 */
+	u16 drawScale;
+
+	/** The snake's starting head x coordinate on the board */
+	u8 startX;
+
+	/** The snake's starting head y coordinate on the board */
+	u8 startY;
+
+	/** The snake's starting facing direction on the board */
+	u8 initialFacing;
+
+	/** Initial length of the snake: shorter lengths make more sense for smaller boards */
+	u32 initialLength;
+
+	/** Number of food cycles after creation before a food expires */
+	u32 foodDuration;
+
+	/** How much length will be added to the snake when he eats */
+	u16 foodIncrement;
+
+	/** How improbable food generation is: larger numbers will take longer time */
+	u16 foodGenerationOneIn;
+} GameConfig;
+
+/** Starting height of the scoreboard for a given game config */
+#define SCORE_BOX_Y(config) ((config)->boardHeight * (config)->drawScale)
 
 /** How long the gameover image stays, as a delay parameter */
 #define GAME_OVER_DURATION 150
@@ -84,30 +93,94 @@ extern u32 SNAKE_INITIAL_LENGTH;
 /** Delay between two game frames, as a keySensitiveDelay parameter */
 #define GAME_FRAME_DELAY 50
 
-/** The snake's starting head x coordinate on the board */
+/** The snake's default starting head x coordinate on the board */
 #define SNAKE_START_X 20
 
-/** The snake's starting head y coordinate on the board */
+/** The snake's default starting head y coordinate on the board */
 #define SNAKE_START_Y 20
 
-/** The snake's starting facing direction on the board */
+/** The snake's default starting facing direction on the board */
 #define SNAKE_INITIAL_FACING RIGHT
 
-/** Maximum number of turns that can be recorded (too small can cause major issues) */
-#define MAX_TURN_COUNT 50
+/**
+ * Number of turns the snake's turn ring buffer starts out with. The buffer
+ * doubles whenever it fills up, so this is not a limit. Must be a power of two.
+ */
+#define INITIAL_TURN_CAPACITY 64
+
+/** Number of cells of the largest board a game can have, which per-cell indices are sized for */
+#define MAX_BOARD_CELLS (LARGE_BOARD_WIDTH * LARGE_BOARD_HEIGHT)
+
+/**
+ * Number of 32-bit words in the snake occupancy bitboard. This is sized for
+ * the LARGE board (about 1 KB).
+ */
+#define OCCUPANCY_WORDS ((MAX_BOARD_CELLS + 31) / 32)
+
+/** Smallest coordinate food can spawn at on a board axis of the given size */
+#define SPAWN_MIN(size) ((size) / 10)
+
+/** Largest coordinate food can spawn at on a board axis of the given size */
+#define SPAWN_MAX(size) (((size) * 9) / 10)
 
-/** Number of food cycles after creation before a food expires*/
+/**
+ * The CollisionEngine new games use. Build with
+ * -DCOLLISION_ENGINE=ENGINE_REFERENCE to run everything on the reference
+ * engine.
+ */
+#ifndef COLLISION_ENGINE
+#define COLLISION_ENGINE ENGINE_BITBOARD
+#endif
+
+/** Default number of food cycles after creation before a food expires*/
 #define FOOD_DURATION 200
 
-/** How much length will be added to the snake when he eats */
+/**
+ * Number of slots in the food timer wheel. This must be a power of two, and
+ * keeping it above the food duration means every food in a slot is due when
+ * the slot comes up.
+ */
+#define FOOD_WHEEL_SLOTS 256
+
+/** Default length that will be added to the snake when he eats */
 #define FOOD_LENGTH_INCREMENT 5
 
-/** How improbable food generation is: larger numbers will take longer time */
+/** Default food generation improbability: larger numbers will take longer time */
 #define FOOD_GENERATION_PROBABILITY_ONE_IN 50
 
-/** The length of the food vector: must be greater than or equal to the largest food number */
+/**
+ * Out of 32768, the chance that a missing food spawns on a given cycle. This
+ * is exactly the chance of qran_range(r, 1, oneIn) returning 1.
+ */
+#define FOOD_SPAWN_CHANCE(oneIn) ((32768 + (oneIn) - 2) / ((oneIn) - 1))
+
+/**
+ * Number of bits of the longest gap between food spawns one draw can
+ * sample. Longer gaps take further draws.
+ */
+#define SPAWN_GAP_BITS 16
+
+/** Largest gap between food spawns one draw can sample */
+#define MAX_SPAWN_GAP_SAMPLE ((1u << SPAWN_GAP_BITS) - 1)
+
+/**
+ * The length of the food vector: must be greater than or equal to the largest
+ * food number. The food timer wheel and the food table can index up to 255
+ * foods.
+ */
 #define MAX_FOOD_COUNT 5
 
+/**
+ * Number of bits of the hash of a cell in the food table, which has
+ * (1 << FOOD_TABLE_BITS) entries. The table must have more entries than
+ * MAX_FOOD_COUNT, and keeping it at least twice as big keeps the probes
+ * short.
+ */
+#define FOOD_TABLE_BITS 4
+
+/** Number of entries in the food table */
+#define FOOD_TABLE_SIZE (1 << FOOD_TABLE_BITS)
+
 /** Number of foods given a score */
 #define FOODCOUNT(score) ((score) < 5000 ? 1 : ((score) < 10000 ? 2 : 3))
 
@@ -135,17 +208,38 @@ extern u32 SNAKE_INITIAL_LENGTH;
 /** How long the splash screen stays, as a vblank count */
 #define SPLASH_COUNTDOWN 2000
 
-/** Debug mode: if toggled on, scoreboard shows tick count */
+/** Seed of the random number stream of the first game after power on */
+#define RANDOM_SEED 42
+
+/** Debug mode: if toggled on, scoreboard shows the frame drawing cost and the game over screen shows the tick profile */
 #define DEBUG_MODE 0
 
 /**
- * This sets the global board w/h, drawscale and snake initial length
- * variables according to the mapSize parameter.
+ * Whether processGame can time its phases into tickProfile. This follows
+ * DEBUG_MODE, so release builds leave the timing out altogether; the host
+ * build turns it on with -DPROFILE_TICKS=1 for cnakeProfile.
+ */
+#ifndef PROFILE_TICKS
+#define PROFILE_TICKS DEBUG_MODE
+#endif
+
+/**
+ * Builds the config of one of the maps the player can choose on the GBA.
+ * Everything but the board size, draw scale and initial length is taken
+ * from the default macros.
  *
- * This was a last minute addition with all four variables originally
- * being concieved as macros, that's why such a sloppy implementation
- * had to be used.
+ * @param  mapSize Size of map: 0 for small, anything else for large.
+ * @return         The config of the chosen map.
+ */
+GameConfig getMapConfig(u16 mapSize);
+
+/**
+ * Parses a custom board given as WIDTHxHEIGHT, e.g. 200x40, into a config
+ * with the LARGE map's settings and the snake starting in the middle of the
+ * board.
  *
- * @param mapSize Size of map: 0 for small, anything else for large.
+ * @param  text   The board to parse.
+ * @param  config Pointer to the config to fill in.
+ * @return        1 if the text is a board a game can be created on, 0 otherwise.
  */
-void setMapSize(u16 mapSize);
+int parseBoardConfig(const char *text, GameConfig *config);
@@ -0,0 +1,413 @@
+#include "cnake.h"
+#include <stddef.h>
+#include <string.h>
+
+/** Number of bytes a GameConfig takes in a snapshot */
+#define SNAPSHOT_CONFIG_SIZE 21
+
+/** Number of bytes a Snake takes in a snapshot, its turns left out */
+#define SNAPSHOT_SNAKE_SIZE 23
+
+/** Number of bytes of the game's own fields: score, cycle, rng, paused, engine and the counts */
+#define SNAPSHOT_GAME_SIZE 20
+
+/** Number of bytes a Food takes in a snapshot */
+#define SNAPSHOT_FOOD_SIZE 8
+
+/** Number of bytes a Turn takes in a snapshot */
+#define SNAPSHOT_TURN_SIZE 3
+
+/**
+ * Gets the number of occupancy bitboard words that cover a game's board.
+ */
+static u32 getBoardWords(Game *g) {
+    return ((u32) g->config.boardWidth * g->config.boardHeight + 31) / 32;
+}
+
+/**
+ * Writes the low bytes of a value out in little-endian order and moves the
+ * output on past them.
+ */
+static void putValue(u8 **out, u32 value, u32 bytes) {
+    for (u32 i = 0; i < bytes; i++) {
+        *(*out)++ = value >> (8 * i);
+    }
+}
+
+/**
+ * Reads a little-endian value of a number of bytes and moves the input on
+ * past it.
+ */
+static u32 getValue(u8 **in, u32 bytes) {
+    u32 value = 0;
+    for (u32 i = 0; i < bytes; i++) {
+        value |= (u32) *(*in)++ << (8 * i);
+    }
+
+    return value;
+}
+
+/**
+ * Checks if a point read from a snapshot is on the game's board.
+ */
+static int isOnBoard(Game *g, Point *p) {
+    return p->x < g->config.boardWidth && p->y < g->config.boardHeight;
+}
+
+/**
+ * Checks the snake and the counts read from a snapshot before anything is
+ * sized or rebuilt from them: the ends of the snake are on the board, the
+ * facings and death cause are ones the game knows, the lengths are in
+ * order and fit the board, and there are no more turns than cells.
+ */
+static int isValidState(Game *g) {
+    Snake *s = &g->snake;
+    u32 cells = (u32) g->config.boardWidth * g->config.boardHeight;
+
+    return  isOnBoard(g, &s->head) && isOnBoard(g, &s->tail) &&
+            s->facing <= RIGHT && s->tailFacing <= RIGHT && s->dead < NUM_DEATH_CAUSES &&
+            s->hiddenLength <= s->length && s->length <= s->growToLength &&
+            s->length - s->hiddenLength < cells && s->numTurns <= MAX_BOARD_CELLS &&
+            g->paused <= 1 && g->engine <= ENGINE_REFERENCE &&
+            g->numFoods <= MAX_FOOD_COUNT && g->numSpawnTimers <= MAX_FOOD_COUNT &&
+            g->numFreeCells <= g->spawnWidth * g->spawnHeight;
+}
+
+/**
+ * Marks the cells of a straight stretch of the body read from a snapshot,
+ * going from one end of it the way the snake went along it. The walk
+ * leaves the board if the other end is not that way, which fails the
+ * check.
+ */
+static int markStretch(Game *g, Point *from, Point *to, Direction d, u32 *cells) {
+    Point p = *from;
+
+    while (1) {
+        u32 cell = p.y * g->config.boardWidth + p.x;
+        cells[cell >> 5] |= 1u << (cell & 31);
+        if (p.x == to->x && p.y == to->y) return 1;
+
+        movePoint(&p, d);
+        if (!isOnBoard(g, &p)) return 0;
+    }
+}
+
+/**
+ * Checks that the body read from a snapshot holds together, so the game
+ * can be played on from it: going from the tail through the turns to the
+ * head, each stretch goes the way the snake went along it, and the cells
+ * covered are exactly the cells of the occupancy bitboard.
+ */
+static int isValidBody(Game *g) {
+    Snake *s = &g->snake;
+    u32 covered[OCCUPANCY_WORDS];
+    memset(covered, 0, sizeof(covered));
+
+    // The snake went along each stretch facing the way it faced before the
+    // turn at its end, and along the last one facing the way it faces now
+    Point *from = &s->tail;
+    for (u32 i = s->numTurns; i > 0; i--) {
+        Turn *t = getTurn(s, i - 1);
+        if (!markStretch(g, from, &t->location, t->previouslyFacing, covered)) return 0;
+
+        from = &t->location;
+    }
+
+    if (!markStretch(g, from, &s->head, s->facing, covered)) return 0;
+
+    // The tail goes the way of the stretch it is on
+    Direction tailFacing = s->numTurns > 0 ? getTurn(s, s->numTurns - 1)->previouslyFacing : s->facing;
+    if (s->tailFacing != tailFacing) return 0;
+
+    return !memcmp(covered, g->occupied, getBoardWords(g) * sizeof(u32));
+}
+
+/**
+ * Rebuilds the position of every spawn margin cell in a game's free cell
+ * index from the cells in it, and checks that they are exactly the cells
+ * of the margin that the occupancy bitboard and the foods leave free.
+ */
+static int indexFreeCells(Game *g) {
+    u32 spawnCells = g->spawnWidth * g->spawnHeight;
+    if (g->numFreeCells > spawnCells) return 0;
+
+    memset(g->freeCellSlot, 0xFF, spawnCells * sizeof(u16));
+    for (u16 i = 0; i < g->numFreeCells; i++) {
+        u16 spawnCell = g->freeCells[i];
+        if (spawnCell >= spawnCells || g->freeCellSlot[spawnCell] != NO_FREE_CELL) return 0;
+
+        g->freeCellSlot[spawnCell] = i;
+    }
+
+    for (u32 spawnCell = 0; spawnCell < spawnCells; spawnCell++) {
+        Point p;
+        p.x = g->spawnX + spawnCell % g->spawnWidth;
+        p.y = g->spawnY + spawnCell / g->spawnWidth;
+
+        int free = !isOccupied(g, &p) && !getFoodAt(g, &p);
+        if (free != (g->freeCellSlot[spawnCell] != NO_FREE_CELL)) return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * Sets up a game's arena in a memory block and copies a game into it, free
+ * cell index included. The turn ring buffer is allocated big enough for
+ * the snake's turns but left for the caller to fill, from the most recent
+ * turn.
+ */
+static Game* startGameCopy(void *memory, Game *state) {
+    Arena arena;
+    initArena(&arena, memory, GAME_ARENA_SIZE);
+
+    Game *g = arenaAlloc(&arena, sizeof(Game));
+    *g = *state;
+    g->arena = arena;
+    g->reference.turns = NULL;
+    g->reference.numTurns = 0;
+    g->reference.capacity = 0;
+
+    // Keep the ring buffer a power of two big enough for every turn
+    Snake *s = &g->snake;
+    s->turnCapacity = INITIAL_TURN_CAPACITY;
+    while (s->turnCapacity < s->numTurns) {
+        s->turnCapacity *= 2;
+    }
+
+    s->newestTurn = 0;
+    s->turns = arenaAlloc(&g->arena, s->turnCapacity * sizeof(Turn));
+
+    // The free cell index gets its own copy in the new arena
+    u32 spawnCells = g->spawnWidth * g->spawnHeight;
+    g->freeCells = arenaAlloc(&g->arena, spawnCells * sizeof(u16));
+    g->freeCellSlot = arenaAlloc(&g->arena, spawnCells * sizeof(u16));
+    if (!s->turns || !g->freeCells || !g->freeCellSlot) {
+        releaseGame(g);
+        return NULL;
+    }
+
+    memcpy(g->freeCells, state->freeCells, g->numFreeCells * sizeof(u16));
+    memcpy(g->freeCellSlot, state->freeCellSlot, spawnCells * sizeof(u16));
+
+    return g;
+}
+
+/**
+ * Finishes a game copy once its turns are in: a game on the reference
+ * engine gets its own turn list back, started over from the ring buffer.
+ */
+static Game* finishGameCopy(Game *g) {
+    if (!setGameEngine(g, g->engine)) {
+        releaseGame(g);
+        return NULL;
+    }
+
+    return g;
+}
+
+u32 getSnapshotSize(Game *g) {
+    return  SNAPSHOT_CONFIG_SIZE + SNAPSHOT_SNAKE_SIZE + SNAPSHOT_GAME_SIZE +
+            g->numFoods * SNAPSHOT_FOOD_SIZE +
+            g->numSpawnTimers * sizeof(u32) +
+            getBoardWords(g) * sizeof(u32) +
+            g->numFreeCells * sizeof(u16) +
+            g->snake.numTurns * SNAPSHOT_TURN_SIZE;
+}
+
+u32 snapshotGame(Game *g, void *buffer) {
+    u8 *out = buffer;
+    GameConfig *c = &g->config;
+    Snake *s = &g->snake;
+
+    putValue(&out, c->boardWidth, 2);
+    putValue(&out, c->boardHeight, 2);
+    putValue(&out, c->drawScale, 2);
+    putValue(&out, c->startX, 1);
+    putValue(&out, c->startY, 1);
+    putValue(&out, c->initialFacing, 1);
+    putValue(&out, c->initialLength, 4);
+    putValue(&out, c->foodDuration, 4);
+    putValue(&out, c->foodIncrement, 2);
+    putValue(&out, c->foodGenerationOneIn, 2);
+
+    putValue(&out, s->head.x, 1);
+    putValue(&out, s->head.y, 1);
+    putValue(&out, s->tail.x, 1);
+    putValue(&out, s->tail.y, 1);
+    putValue(&out, s->length, 4);
+    putValue(&out, s->growToLength, 4);
+    putValue(&out, s->hiddenLength, 4);
+    putValue(&out, s->numTurns, 4);
+    putValue(&out, s->facing, 1);
+    putValue(&out, s->tailFacing, 1);
+    putValue(&out, s->dead, 1);
+
+    putValue(&out, g->score, 4);
+    putValue(&out, g->currentCycle, 4);
+    putValue(&out, g->rng.seed, 4);
+    putValue(&out, g->paused, 1);
+    putValue(&out, g->engine, 1);
+    putValue(&out, g->numFoods, 2);
+    putValue(&out, g->numSpawnTimers, 2);
+    putValue(&out, g->numFreeCells, 2);
+
+    for (u16 i = 0; i < g->numFoods; i++) {
+        Food *f = &g->foods[i];
+        putValue(&out, f->location.x, 1);
+        putValue(&out, f->location.y, 1);
+        putValue(&out, f->value, 2);
+        putValue(&out, f->deleteOnCycle, 4);
+    }
+
+    for (u16 i = 0; i < g->numSpawnTimers; i++) {
+        putValue(&out, g->spawnOnCycle[i], 4);
+    }
+
+    for (u32 i = 0; i < getBoardWords(g); i++) {
+        putValue(&out, g->occupied[i], 4);
+    }
+
+    for (u16 i = 0; i < g->numFreeCells; i++) {
+        putValue(&out, g->freeCells[i], 2);
+    }
+
+    for (u32 i = 0; i < s->numTurns; i++) {
+        Turn *t = getTurn(s, i);
+        putValue(&out, t->location.x, 1);
+        putValue(&out, t->location.y, 1);
+        putValue(&out, t->previouslyFacing, 1);
+    }
+
+    return out - (u8 *) buffer;
+}
+
+Game* restoreGame(void *memory, void *snapshot) {
+    u8 *in = snapshot;
+
+    GameConfig config;
+    config.boardWidth = getValue(&in, 2);
+    config.boardHeight = getValue(&in, 2);
+    config.drawScale = getValue(&in, 2);
+    config.startX = getValue(&in, 1);
+    config.startY = getValue(&in, 1);
+    config.initialFacing = getValue(&in, 1);
+    config.initialLength = getValue(&in, 4);
+    config.foodDuration = getValue(&in, 4);
+    config.foodIncrement = getValue(&in, 2);
+    config.foodGenerationOneIn = getValue(&in, 2);
+
+    // Start from a new game on the config, which sets up everything that
+    // follows from the config alone
+    Game *g = initGame(memory, &config, 0);
+    if (!g) return NULL;
+
+    Snake *s = &g->snake;
+    s->head.x = getValue(&in, 1);
+    s->head.y = getValue(&in, 1);
+    s->tail.x = getValue(&in, 1);
+    s->tail.y = getValue(&in, 1);
+    s->length = getValue(&in, 4);
+    s->growToLength = getValue(&in, 4);
+    s->hiddenLength = getValue(&in, 4);
+    s->numTurns = getValue(&in, 4);
+    s->facing = getValue(&in, 1);
+    s->tailFacing = getValue(&in, 1);
+    s->dead = getValue(&in, 1);
+
+    g->score = getValue(&in, 4);
+    g->currentCycle = getValue(&in, 4);
+    g->rng.seed = getValue(&in, 4);
+    g->paused = getValue(&in, 1);
+    g->engine = getValue(&in, 1);
+    g->numFoods = getValue(&in, 2);
+    g->numSpawnTimers = getValue(&in, 2);
+    g->numFreeCells = getValue(&in, 2);
+
+    if (!isValidState(g)) {
+        releaseGame(g);
+        return NULL;
+    }
+
+    for (u16 i = 0; i < g->numFoods; i++) {
+        Food *f = &g->foods[i];
+        f->location.x = getValue(&in, 1);
+        f->location.y = getValue(&in, 1);
+        f->value = getValue(&in, 2);
+        f->deleteOnCycle = getValue(&in, 4);
+
+        // Every food is on its own cell of the board
+        if (!isOnBoard(g, &f->location) || getFoodAt(g, &f->location)) {
+            releaseGame(g);
+            return NULL;
+        }
+
+        scheduleFood(g, i);
+        indexFood(g, i);
+    }
+
+    for (u16 i = 0; i < g->numSpawnTimers; i++) {
+        g->spawnOnCycle[i] = getValue(&in, 4);
+    }
+
+    for (u32 i = 0; i < getBoardWords(g); i++) {
+        g->occupied[i] = getValue(&in, 4);
+    }
+
+    for (u16 i = 0; i < g->numFreeCells; i++) {
+        g->freeCells[i] = getValue(&in, 2);
+    }
+
+    if (!indexFreeCells(g)) {
+        releaseGame(g);
+        return NULL;
+    }
+
+    // Make the ring buffer a power of two big enough for every turn, which
+    // isValidState keeps within reach of the doubling
+    if (s->numTurns > s->turnCapacity) {
+        while (s->turnCapacity < s->numTurns) {
+            s->turnCapacity *= 2;
+        }
+
+        s->turns = arenaAlloc(&g->arena, s->turnCapacity * sizeof(Turn));
+        if (!s->turns) {
+            releaseGame(g);
+            return NULL;
+        }
+    }
+
+    s->newestTurn = 0;
+    for (u32 i = 0; i < s->numTurns; i++) {
+        Turn *t = &s->turns[i];
+        t->location.x = getValue(&in, 1);
+        t->location.y = getValue(&in, 1);
+        t->previouslyFacing = getValue(&in, 1);
+
+        if (!isOnBoard(g, &t->location) || t->previouslyFacing > RIGHT) {
+            releaseGame(g);
+            return NULL;
+        }
+    }
+
+    if (!isValidBody(g)) {
+        releaseGame(g);
+        return NULL;
+    }
+
+    // Everything else follows from the state read back
+    g->hash = computeGameHash(g);
+
+    return finishGameCopy(g);
+}
+
+Game* cloneGame(void *memory, Game *g) {
+    Game *copy = startGameCopy(memory, g);
+    if (!copy) return NULL;
+
+    for (u32 i = 0; i < g->snake.numTurns; i++) {
+        copy->snake.turns[i] = *getTurn(&g->snake, i);
+    }
+
+    return finishGameCopy(copy);
+}
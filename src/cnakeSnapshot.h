@@ -0,0 +1,80 @@
+/**
+ * @file
+ * @author Cem Gokmen
+ * @date 2 Apr 2017
+ * @brief This file contains the cnake game snapshot functions.
+ */
+
+/**
+ * Gets the number of bytes snapshotGame needs to save a game. This depends
+ * on the board size and the number of turns on the snake's body, so it
+ * changes as the game goes on.
+ *
+ * @param  g Pointer to the game to measure.
+ * @return   Size of the game's snapshot in bytes.
+ */
+u32 getSnapshotSize(Game *g);
+
+/**
+ * Saves the complete state of a game into a flat buffer, so that restoring
+ * it gives a game that plays out exactly like the saved one. Every field is
+ * written on its own at a fixed width in little-endian order, so the buffer
+ * reads the same on the GBA and on any host. It holds, one after the other:
+ *
+ * - the config fields, in the order GameConfig declares them
+ * - the snake's head, tail, lengths, number of turns, facings and death cause
+ * - score, cycle, rng seed, paused, engine and the numbers of foods, spawn
+ *   timers and free cells
+ * - each food's cell, value and deleteOnCycle
+ * - each spawn timer's cycle
+ * - the occupancy bitboard words covering the board
+ * - the free cell index, in its order, 2 bytes per free cell
+ * - the turns on the snake's body, from the most recent one, 3 bytes each
+ *
+ * What follows from these is left out and rebuilt by restoreGame: the
+ * spawn margin, the position of each cell in the free cell index, the food
+ * timer wheel and table, the spawn gap powers, the hash and the reference
+ * engine's turn list. The order of the free cell index cannot be rebuilt,
+ * as the next food spawn draws from it. The buffer
+ * has no alignment requirement.
+ *
+ * @param  g      Pointer to the game to save.
+ * @param  buffer Pointer to at least getSnapshotSize(g) bytes to save it to.
+ * @return        Number of bytes written.
+ */
+u32 snapshotGame(Game *g, void *buffer);
+
+/**
+ * Creates a game from a snapshot in a memory block owned by the caller,
+ * like initGame does from a config. To roll a game back, release it and
+ * restore the snapshot into the same block.
+ *
+ * Like initGame, the arena grows for the free cell index, and again if the
+ * snake has more turns than the initial turn ring buffer holds.
+ *
+ * The snapshot is checked as it is read: the config like initGame checks
+ * it, every cell on the board, the facings and death cause known, the
+ * lengths in order, at most MAX_BOARD_CELLS turns, at most MAX_FOOD_COUNT
+ * foods and spawn timers, no two foods on a cell, a body that goes from the
+ * tail through the turns to the head the way the snake faced and covers
+ * exactly the cells of the occupancy bitboard, and a free cell index that
+ * lists exactly the free cells of the spawn margin.
+ *
+ * @param  memory   Pointer to a block of GAME_ARENA_SIZE bytes, aligned for any type.
+ * @param  snapshot Pointer to a snapshot written by snapshotGame.
+ * @return          Pointer to the restored game, or NULL if the snapshot
+ *                  fails one of the checks or there is no memory left for
+ *                  it.
+ */
+Game* restoreGame(void *memory, void *snapshot);
+
+/**
+ * Copies a game into a memory block owned by the caller. This gives the same
+ * game as a snapshot and restore, without the intermediate buffer.
+ *
+ * @param  memory Pointer to a block of GAME_ARENA_SIZE bytes, aligned for any type.
+ * @param  g      Pointer to the game to copy.
+ * @return        Pointer to the copy, or NULL if there is no memory left
+ *                for its turns or free cell index.
+ */
+Game* cloneGame(void *memory, Game *g);
@@ -0,0 +1,18 @@
+/**
+ * @file
+ * @author Cem Gokmen
+ * @date 2 Apr 2017
+ * @brief This file contains the fixed width types shared by the GBA and host builds.
+ */
+
+/** An unsigned 64-bit (8-byte) type, for intermediate fixed point products */
+typedef unsigned long long u64;
+
+/** An unsigned 32-bit (4-byte) type */
+typedef unsigned int u32;
+
+/** An unsigned 16-bit (2-byte) type */
+typedef unsigned short u16;
+
+/** An unsigned 8-bit (1-byte) type. Note that this type cannot be written onto RAM directly. */
+typedef unsigned char u8;
@@ -27,6 +27,8 @@
 #define BUFFER1FLAG 0x10
 
 #define SCANLINECOUNTER *(volatile u16 *)0x4000006
+#define SCANLINE_CYCLES 1232
+#define FRAME_SCANLINES 228
 
 // DMA
 typedef struct
@@ -17,6 +17,10 @@ typedef enum {
 	GAMEOVER_NODRAW,
 } GBAState;
 
+// Static data goes to IWRAM, so the game is kept there rather than on the
+// heap in EWRAM. Only turns beyond the initial ring buffer go to the heap.
+static u64 gameMemory[(GAME_ARENA_SIZE + 7) / 8];
+
 int main() {
 	GBAState state = SPLASH;
 
@@ -34,6 +38,10 @@ int main() {
 
 	short countDown = SPLASH_COUNTDOWN;
 	u16 mapSize = 0;
+	GameConfig config;
+
+	// Each game continues the random stream of the previous one
+	u32 seed = RANDOM_SEED;
 
     Game *g;
     u32 highScore = 0;
@@ -41,6 +49,18 @@ int main() {
 
 	u16 *currentBuffer;
 
+	// In debug mode, every tick's phases and every frame's drawing are
+	// timed in CPU cycles
+	TickProfile profile;
+	RenderProfile frameProfile;
+	if (DEBUG_MODE) {
+		startCycleCounter();
+		initTickProfile(&profile, readCycleCounter, CYCLE_COUNTER_HZ);
+		tickProfile = &profile;
+		resetRenderProfile(&frameProfile);
+		renderProfile = &frameProfile;
+	}
+
 	while(1) {
 		pressedA = KEY_DOWN_NOW(BUTTON_A);
 		pressedSelect = KEY_DOWN_NOW(BUTTON_SELECT);
@@ -120,7 +140,7 @@ int main() {
 
 			break;
         case GAME_INIT:
-			setMapSize(mapSize);
+			config = getMapConfig(mapSize);
 
 			waitForVBlank();
 			fillPalette();
@@ -129,15 +149,23 @@ int main() {
 			REG_DISPCNT = MODE_4 | BG2_EN;
 			currentBuffer = flipPage();
 
-            g = createGame();
+            g = initGame(gameMemory, &config, seed);
+			if (!g) {
+				// Invalid config or no memory left: go back to the start screen
+				state = START;
+				break;
+			}
+
+			if (tickProfile) resetTickProfile(tickProfile);
+			if (renderProfile) resetRenderProfile(renderProfile);
 
 			state = GAME;
 			break;
 		case GAME:
-            if (g->snake->dead) {
+            if (g->snake.dead) {
 				// Draw the dead image
 				drawGame(currentBuffer, g);
-				drawImage4(currentBuffer, 0, 0, 240, (SNAKE_BOARD_HEIGHT - 1) * DRAW_SCALE, (u16*) deadImage);
+				drawImage4(currentBuffer, 0, 0, 240, (g->config.boardHeight - 1) * g->config.drawScale, (u16*) deadImage);
 
 				waitForVBlank();
 				currentBuffer = flipPage();
@@ -149,11 +177,13 @@ int main() {
                 state = GAMEOVER;
 
 				// Let's get rid of the game.
-				freeGame(g);
+				seed = g->rng.seed;
+				releaseGame(g);
             } else {
 				// Cancel the game if necessary
 				if (pressedSelect && !previouslyPressedSelect) {
-					freeGame(g);
+					seed = g->rng.seed;
+					releaseGame(g);
 					state = START;
 					break;
 				}
@@ -164,7 +194,7 @@ int main() {
 				}
 
                 // Process the state
-                processGame(g, keySensitiveDelay(GAME_FRAME_DELAY));
+                processGame(g, keysToInput(keySensitiveDelay(GAME_FRAME_DELAY) | ~(BUTTONS)));
 
 				// We draw the game onto a temporary buffer first
 				drawGame(currentBuffer, g);
@@ -192,11 +222,17 @@ int main() {
 			drawString3(videoBuffer, 10, 40, highScoreText, WHITE);
 			drawString3(videoBuffer, 10, 60, "Press A to retry", WHITE);
 
-			drawString3(videoBuffer, 10, 80, "Credits:", GREEN);
-			drawString3(videoBuffer, 10, 100, "cnake was developed for GT CS2110", WHITE);
-			drawString3(videoBuffer, 10, 110, "by Cem Gokmen <cgokmen@gatech.edu>", WHITE);
-			drawString3(videoBuffer, 10, 120, "(http://github.com/skyman/cnake)", WHITE);
-			drawString3(videoBuffer, 10, 140, "2017, All Rights Reserved.", WHITE);
+			if (DEBUG_MODE) {
+				// Show where the ticks of the game went instead of the credits
+				drawString3(videoBuffer, 10, 70, "phase      mean    p99     max", GREEN);
+				drawTickProfile3(videoBuffer, 79, tickProfile);
+			} else {
+				drawString3(videoBuffer, 10, 80, "Credits:", GREEN);
+				drawString3(videoBuffer, 10, 100, "cnake was developed for GT CS2110", WHITE);
+				drawString3(videoBuffer, 10, 110, "by Cem Gokmen <cgokmen@gatech.edu>", WHITE);
+				drawString3(videoBuffer, 10, 120, "(http://github.com/skyman/cnake)", WHITE);
+				drawString3(videoBuffer, 10, 140, "2017, All Rights Reserved.", WHITE);
+			}
 
 			state = GAMEOVER_NODRAW;
 			break;
@@ -25,20 +25,34 @@ void waitForVBlank() {
 	while(SCANLINECOUNTER < 159);
 }
 
-// Random Number Generator
-// Courtesy of Tonc
-int __qran_seed= 42;
-int sqran(int seed) {
-    int old= __qran_seed;
-    __qran_seed= seed;
-    return old;
+void startCycleCounter() {
+	REG_TM0CNT_H = 0;
+	REG_TM1CNT_H = 0;
+	REG_TM0CNT_L = 0;
+	REG_TM1CNT_L = 0;
+
+	// Start the high half first so it sees every overflow of the low half
+	REG_TM1CNT_H = TIMER_ON | TIMER_CASCADE;
+	REG_TM0CNT_H = TIMER_ON;
 }
 
-int qran() {
-    __qran_seed= 1664525*__qran_seed+1013904223;
-    return (__qran_seed>>16) & 0x7FFF;
+u32 readCycleCounter() {
+	// Read the high half again in case the low half overflowed in between
+	u16 high = REG_TM1CNT_L;
+	u16 low = REG_TM0CNT_L;
+	u16 highAgain = REG_TM1CNT_L;
+	if (high != highAgain) low = REG_TM0CNT_L;
+
+	return ((u32) highAgain << 16) | low;
 }
 
-int qran_range(int min, int max) {
-	return (qran()*(max-min)>>15)+min;
+u32 keysToInput(u32 keys) {
+	u32 input = INPUT_NONE;
+
+	if (keys & BUTTON_UP) input |= INPUT_UP;
+	if (keys & BUTTON_DOWN) input |= INPUT_DOWN;
+	if (keys & BUTTON_LEFT) input |= INPUT_LEFT;
+	if (keys & BUTTON_RIGHT) input |= INPUT_RIGHT;
+
+	return input;
 }
@@ -5,14 +5,7 @@
  * @brief This file contains generic library functions and includes the other headers.
  */
 
-/** An unsigned 32-bit (4-byte) type */
-typedef unsigned int u32;
-
-/** An unsigned 16-bit (2-byte) type */
-typedef unsigned short u16;
-
-/** An unsigned 8-bit (1-byte) type. Note that this type cannot be written onto RAM directly. */
-typedef unsigned char u8;
+#include "cnake.h"
 
 /** The video buffer pointer for drawing in Mode 3 */
 extern u16 *videoBuffer;
@@ -31,6 +24,17 @@ extern u16 *videoBuffer;
 #define KEY_DOWN_NOW(key)  (~(BUTTONS) & (key))
 #define BUTTONS *(volatile u32 *)0x4000130
 
+// Timers
+#define REG_TM0CNT_L *(volatile u16 *)0x4000100
+#define REG_TM0CNT_H *(volatile u16 *)0x4000102
+#define REG_TM1CNT_L *(volatile u16 *)0x4000104
+#define REG_TM1CNT_H *(volatile u16 *)0x4000106
+#define TIMER_CASCADE	(1<<2)
+#define TIMER_ON		(1<<7)
+
+/** Number of times the cycle counter ticks in a second: once per CPU cycle */
+#define CYCLE_COUNTER_HZ 16777216
+
 /**
  * Runs a blocking loop.
  * @param n How long to run loop for
@@ -50,17 +54,24 @@ u32 keySensitiveDelay(int n);
 void waitForVBlank();
 
 /**
- * Generates a pseudo-random number between min and max, inclusive.
- *
- * I totally snatched this function from tonc.
- *
- * @param  min bottom end of range.
- * @param  max top end of range.
- * @return     random number in the given range.
+ * Starts timers 0 and 1 as a 32-bit counter of CPU cycles from 0: timer 0
+ * counts cycles and timer 1 counts every time timer 0 overflows.
+ */
+void startCycleCounter();
+
+/**
+ * Reads the cycle counter started by startCycleCounter. It wraps around
+ * about every four minutes.
+ * @return The number of CPU cycles since the counter was started
+ */
+u32 readCycleCounter();
+
+/**
+ * Converts a merged bitvector of key presses into cnake Input flags.
+ * @param keys Merged key press vector, as returned by keySensitiveDelay
+ * @return     The Input flags of the pressed arrows
  */
-int qran_range(int min, int max);
+u32 keysToInput(u32 keys);
 
 #include "gbaGraphics.h"
-#include "cnakeSettings.h"
-#include "cnakeLogic.h"
 #include "cnakeGraphics.h"
@@ -0,0 +1,359 @@
+// Times the collision, containment, food and turn hot paths of the logic
+// on snakes of every length, shape and board fill, and prints one CSV row
+// per measurement.
+//
+// usage: cnakeBench [-n samples] [-s seed]
+//
+// Snakes are laid out by playing a game along a boustrophedon path that
+// sweeps the board in vertical bands. Narrow bands give a turn every couple
+// of cells, a band as wide as the board only turns at its edges. The fills
+// all leave free cells in the spawn margin, so every food spawn succeeds.
+// Each sample is a batch of calls timed together, with the cost of reading
+// the clock taken off, divided by the number of calls: the clock costs as
+// much as the fastest calls, so timing them one by one would mostly time
+// the clock. Whatever a call needs is drawn before its batch starts.
+//
+// The collision checks and the food spawn are timed with every engine, the
+// reference included. The self collision check is made the way a tick
+// makes it: with the head moved onto the free cell ahead of it, before that
+// cell is marked as occupied, so it never finds a hit early and goes over
+// the whole body.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "cnake.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/** Number of band widths the path is laid out with, besides the full board width */
+#define BAND_WIDTHS 3
+
+/** Number of board fill ratios measured */
+#define FILL_RATIOS 6
+
+/** Number of calls timed together in a sample */
+#define BATCH_CALLS 16
+
+static const u32 bandWidths[BAND_WIDTHS] = { 2, 4, 16 };
+
+/** Fill ratios in percent of the cells inside the walls */
+static const u32 fillRatios[FILL_RATIOS] = { 1, 10, 25, 50, 75, 85 };
+
+static const char *engineNames[3] = { "bitboard", "segments", "reference" };
+
+static u32 numSamples = 2000;
+static u32 *samples;
+static u64 timerOverhead;
+
+static u64 now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (u64) t.tv_sec * 1000000000u + t.tv_nsec;
+}
+
+static int compareSamples(const void *a, const void *b) {
+    u32 x = *(const u32 *) a, y = *(const u32 *) b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * Measures what reading the clock twice costs, which every sample pays.
+ */
+static void calibrateTimer(void) {
+    for (u32 i = 0; i < numSamples; i++) {
+        u64 start = now();
+        samples[i] = now() - start;
+    }
+
+    qsort(samples, numSamples, sizeof(u32), compareSamples);
+    timerOverhead = samples[numSamples / 2];
+}
+
+/**
+ * Adds one timed batch of calls to the samples as the time per call, minus
+ * the clock overhead.
+ */
+static void addSample(u32 i, u64 start, u64 stop, u32 calls) {
+    u64 elapsed = stop - start;
+    samples[i] = elapsed > timerOverhead ? (elapsed - timerOverhead) / calls : 0;
+}
+
+/**
+ * Prints the CSV row of one measurement from its samples.
+ */
+static void report(const char *board, Game *g, u32 band, u32 fill, const char *engine, const char *op, u32 calls) {
+    u64 sum = 0;
+    for (u32 i = 0; i < numSamples; i++) sum += samples[i];
+    qsort(samples, numSamples, sizeof(u32), compareSamples);
+
+    printf("%s,%u,%u,%u,%u,%u,%u,%s,%s,%u,%u,%.1f,%u,%u,%u\n",
+        board, g->config.boardWidth, g->config.boardHeight, band, fill,
+        g->snake.length, g->snake.numTurns, engine, op, numSamples, calls,
+        (double) sum / numSamples, samples[numSamples / 2],
+        samples[(u64) numSamples * 99 / 100], samples[numSamples - 1]);
+}
+
+/**
+ * Builds the path the snake is laid out along: the cells inside the walls,
+ * band by band, going down the even bands and up the odd ones, with the
+ * rows of a band going alternately right and left. Bands use an odd number
+ * of rows so each ends next to where the following one starts.
+ */
+static u32 buildPath(GameConfig *config, u32 band, Point *path) {
+    u32 rows = config->boardHeight - 2;
+    if (rows % 2 == 0) rows--;
+
+    u32 length = 0;
+    for (u32 left = 1, k = 0; left < config->boardWidth - 1u; left += band, k++) {
+        u32 right = left + band - 1 < config->boardWidth - 2u ? left + band - 1 : config->boardWidth - 2u;
+
+        for (u32 r = 0; r < rows; r++) {
+            u32 y = k % 2 == 0 ? 1 + r : rows - r;
+            for (u32 c = 0; c <= right - left; c++) {
+                path[length].x = r % 2 == 0 ? left + c : right - c;
+                path[length].y = y;
+                length++;
+            }
+        }
+    }
+
+    return length;
+}
+
+static Direction getStep(Point *from, Point *to) {
+    if (to->x > from->x) return RIGHT;
+    if (to->x < from->x) return LEFT;
+    return to->y > from->y ? DOWN : UP;
+}
+
+/**
+ * Plays a game that lays a snake of the given length out along the path.
+ * The whole length starts hidden in the wall behind the first cell, so the
+ * body on the board grows by a cell every tick. Foods never spawn, so the
+ * snake cannot grow any further. Returns NULL if there was no memory for
+ * the game.
+ */
+static Game* layOutSnake(GameConfig *base, Point *path, u32 length, u32 seed) {
+    GameConfig config = *base;
+    config.startX = path[0].x;
+    config.startY = path[0].y;
+    config.initialFacing = getStep(&path[0], &path[1]);
+    config.initialLength = length;
+    config.foodGenerationOneIn = 0xFFFF;
+
+    Game *g = createGame(&config, seed);
+    if (!g) return NULL;
+
+    for (u32 t = 1; t < length; t++) {
+        processGame(g, 1u << getStep(&path[t], &path[t + 1]));
+
+        // Keep the board free of food whatever the spawn timers do
+        while (g->numFoods) removeFood(g, 0);
+    }
+
+    return g;
+}
+
+static Point randomPoint(Game *g, Rng *r) {
+    Point p;
+    p.x = qran_range(r, 1, g->config.boardWidth - 1);
+    p.y = qran_range(r, 1, g->config.boardHeight - 1);
+    return p;
+}
+
+/**
+ * Gets one of the ends of the body segments: the head, a turn or the tail.
+ */
+static Point* getSegmentEnd(Snake *s, u32 i) {
+    if (i == 0) return &s->head;
+    if (i > s->numTurns) return &s->tail;
+    return &getTurn(s, i - 1)->location;
+}
+
+/**
+ * Times every operation on one snake. Returns NULL, or what went wrong.
+ */
+static const char* benchScenario(const char *board, GameConfig *config, u32 band, u32 fill, Point *path, Rng *r) {
+    u32 pathLength = buildPath(config, band, path);
+    u32 length = (u32) (config->boardWidth - 2) * (config->boardHeight - 2) * fill / 100;
+    if (length < 2) length = 2;
+    if (length > pathLength - 2) length = pathLength - 2;
+
+    Game *g = layOutSnake(config, path, length, qran(r));
+    if (!g) return "out of memory";
+
+    Snake *s = &g->snake;
+    Point points[BATCH_CALLS];
+
+    for (u8 engine = ENGINE_BITBOARD; engine <= ENGINE_REFERENCE; engine++) {
+        if (!setGameEngine(g, engine)) {
+            freeGame(g);
+            return "out of memory";
+        }
+
+        // The snake was laid out facing the next cell of the path, which is free
+        Point head = s->head;
+        movePoint(&s->head, s->facing);
+
+        for (u32 i = 0; i < numSamples; i++) {
+            u64 start = now();
+            for (u32 k = 0; k < BATCH_CALLS; k++) {
+                volatile int hit = checkSelfCollision(g, 1);
+                (void) hit;
+            }
+            addSample(i, start, now(), BATCH_CALLS);
+        }
+        report(board, g, band, fill, engineNames[engine], "checkSelfCollision", BATCH_CALLS);
+
+        s->head = head;
+
+        for (u32 i = 0; i < numSamples; i++) {
+            for (u32 k = 0; k < BATCH_CALLS; k++) {
+                points[k] = randomPoint(g, r);
+            }
+
+            u64 start = now();
+            for (u32 k = 0; k < BATCH_CALLS; k++) {
+                Food f;
+                f.location = points[k];
+                volatile int hit = checkFoodCollision(g, &f);
+                (void) hit;
+            }
+            addSample(i, start, now(), BATCH_CALLS);
+        }
+        report(board, g, band, fill, engineNames[engine], "checkFoodCollision", BATCH_CALLS);
+
+        // A batch fills the food array, and is taken back right away so the
+        // board keeps its fill
+        for (u32 i = 0; i < numSamples; i++) {
+            u32 spawned = 0;
+
+            u64 start = now();
+            for (u32 k = 0; k < MAX_FOOD_COUNT; k++) {
+                spawned += createRandomFood(g) != NULL;
+            }
+            addSample(i, start, now(), MAX_FOOD_COUNT);
+
+            if (spawned != MAX_FOOD_COUNT) {
+                freeGame(g);
+                return "no free cell to spawn a food on";
+            }
+
+            while (g->numFoods) removeFood(g, 0);
+        }
+        report(board, g, band, fill, engineNames[engine], "createRandomFood", MAX_FOOD_COUNT);
+    }
+
+    if (!setGameEngine(g, COLLISION_ENGINE)) {
+        freeGame(g);
+        return "out of memory";
+    }
+
+    // Every batch of turns is rolled back right away so the history keeps
+    // its length
+    void *memory = g->arena.firstBase;
+    u8 *snapshot = malloc(getSnapshotSize(g));
+    if (!snapshot) {
+        freeGame(g);
+        return "out of memory";
+    }
+
+    snapshotGame(g, snapshot);
+    for (u32 i = 0; i < numSamples; i++) {
+        Direction across = s->facing == UP || s->facing == DOWN ? LEFT : UP;
+        Direction along = s->facing;
+
+        u64 start = now();
+        for (u32 k = 0; k < BATCH_CALLS; k++) {
+            turnSnake(g, k % 2 == 0 ? across : along);
+        }
+        addSample(i, start, now(), BATCH_CALLS);
+
+        releaseGame(g);
+        g = restoreGame(memory, snapshot);
+        if (!g) {
+            free(memory);
+            free(snapshot);
+            return "out of memory";
+        }
+
+        s = &g->snake;
+    }
+    free(snapshot);
+    report(board, g, band, fill, "-", "turnSnake", BATCH_CALLS);
+
+    for (u32 i = 0; i < numSamples; i++) {
+        u32 ends[BATCH_CALLS];
+        for (u32 k = 0; k < BATCH_CALLS; k++) {
+            points[k] = randomPoint(g, r);
+            ends[k] = qran_index(r, s->numTurns + 1);
+        }
+
+        u64 start = now();
+        for (u32 k = 0; k < BATCH_CALLS; k++) {
+            volatile int hit = isBetween(&points[k], getSegmentEnd(s, ends[k]), getSegmentEnd(s, ends[k] + 1));
+            (void) hit;
+        }
+        addSample(i, start, now(), BATCH_CALLS);
+    }
+    report(board, g, band, fill, "-", "isBetween", BATCH_CALLS);
+
+    freeGame(g);
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    u32 seed = RANDOM_SEED;
+
+    int option;
+    while ((option = getopt(argc, argv, "n:s:")) != -1) {
+        switch (option) {
+            case 'n':
+                numSamples = strtoul(optarg, NULL, 10);
+                break;
+            case 's':
+                seed = strtoul(optarg, NULL, 10);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n samples] [-s seed]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (numSamples == 0) numSamples = 1;
+    samples = malloc(numSamples * sizeof(u32));
+    Point *path = malloc(MAX_BOARD_CELLS * sizeof(Point));
+    if (!samples || !path) {
+        fprintf(stderr, "%s: out of memory\n", argv[0]);
+        return 1;
+    }
+
+    Rng r;
+    sqran(&r, seed);
+    calibrateTimer();
+
+    printf("board,width,height,band,fill_percent,length,turns,engine,op,samples,calls_per_sample,mean_ns,p50_ns,p99_ns,max_ns\n");
+
+    for (u16 mapSize = 0; mapSize < 2; mapSize++) {
+        GameConfig config = getMapConfig(mapSize);
+        const char *board = mapSize ? "large" : "small";
+
+        for (u32 b = 0; b <= BAND_WIDTHS; b++) {
+            u32 band = b < BAND_WIDTHS ? bandWidths[b] : config.boardWidth - 2u;
+
+            for (u32 f = 0; f < FILL_RATIOS; f++) {
+                const char *error = benchScenario(board, &config, band, fillRatios[f], path, &r);
+                if (error) {
+                    fprintf(stderr, "%s: %s\n", argv[0], error);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    free(path);
+    free(samples);
+    return 0;
+}
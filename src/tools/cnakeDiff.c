@@ -0,0 +1,275 @@
+// Plays every game twice side by side, once on an optimized collision engine
+// and once on the reference engine, and stops at the first tick where the
+// two games differ.
+//
+// usage: cnakeDiff [-g games] [-s seed] [-n maxTicks] [-e bitboard|segments]
+//
+// Game i uses seed + i, a board and a scripted player picked from i, and
+// the same input in both games: the input the player picks for the
+// optimized one. On a difference the seed, the tick and both states are
+// printed, which is all it takes to replay the game.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "cnake.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/** Number of boards the games are spread over */
+#define BOARDS 6
+
+/** Number of ticks between copies of the reference game */
+#define COPY_INTERVAL 997
+
+static u32 traced[OCCUPANCY_WORDS];
+
+/**
+ * Builds the config of a game: SMALL, LARGE, two odd custom boards, a
+ * cramped one where the body fills most of the spawn margin and the free
+ * cell index gets short, and a narrow one where the body folds back and
+ * forth and keeps more turns than the initial turn ring buffer holds.
+ */
+static GameConfig getDiffConfig(u32 board) {
+    GameConfig config = getMapConfig(board & 1);
+
+    if (board == 2) {
+        config.boardWidth = 200;
+        config.boardHeight = 40;
+        config.startY = 20;
+        config.foodGenerationOneIn = 3;
+        config.foodDuration = 90;
+    } else if (board == 3) {
+        config.boardWidth = 25;
+        config.boardHeight = 25;
+        config.startX = 12;
+        config.startY = 3;
+        config.initialLength = 50;
+        config.initialFacing = DOWN;
+    } else if (board == 4) {
+        config.boardWidth = 12;
+        config.boardHeight = 12;
+        config.startX = 4;
+        config.startY = 1;
+        config.initialLength = 20;
+        config.foodGenerationOneIn = 2;
+        config.foodDuration = 60;
+    } else if (board == 5) {
+        config.boardWidth = 12;
+        config.boardHeight = 100;
+        config.startX = 4;
+        config.startY = 1;
+        config.initialLength = 600;
+    }
+
+    return config;
+}
+
+/**
+ * Checks the foods of two games, field by field.
+ */
+static int isSameFoods(Game *a, Game *b) {
+    if (a->numFoods != b->numFoods) {
+        return 0;
+    }
+
+    for (u16 i = 0; i < a->numFoods; i++) {
+        Food *f = &a->foods[i], *e = &b->foods[i];
+        if (f->location.x != e->location.x || f->location.y != e->location.y ||
+            f->value != e->value || f->deleteOnCycle != e->deleteOnCycle) {
+                return 0;
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * Checks the state that changes every tick and decides how the game goes
+ * on. The bodies are compared once a game is over.
+ */
+static int isSameTick(Game *a, Game *b) {
+    Snake *s = &a->snake, *t = &b->snake;
+    return  a->currentCycle == b->currentCycle && a->score == b->score &&
+            a->rng.seed == b->rng.seed &&
+            s->head.x == t->head.x && s->head.y == t->head.y &&
+            s->length == t->length && s->growToLength == t->growToLength &&
+            s->facing == t->facing && s->dead == t->dead &&
+            isSameFoods(a, b);
+}
+
+/**
+ * Compares the complete states of an optimized game and a reference one,
+ * field by field: everything isSameTick checks, the spawn timers, and the
+ * cells the optimized game's occupancy bitboard covers against the cells
+ * the reference game's walk of its own turn list covers. The optimized
+ * game's free cell index is checked against that walk and the foods: it
+ * must list every cell of the spawn margin they leave free, once, and
+ * know where it lists each of them.
+ */
+static int isSameGame(Game *a, Game *b) {
+    if (!isSameTick(a, b) || a->paused != b->paused || a->numSpawnTimers != b->numSpawnTimers) {
+        return 0;
+    }
+
+    for (u16 i = 0; i < a->numSpawnTimers; i++) {
+        if (a->spawnOnCycle[i] != b->spawnOnCycle[i]) return 0;
+    }
+
+    traceSnakeCells(b, traced);
+
+    u32 words = ((u32) a->config.boardWidth * a->config.boardHeight + 31) / 32;
+    for (u32 i = 0; i < words; i++) {
+        if (a->occupied[i] != traced[i]) return 0;
+    }
+
+    for (u16 i = 0; i < b->numFoods; i++) {
+        u32 cell = b->foods[i].location.y * b->config.boardWidth + b->foods[i].location.x;
+        traced[cell >> 5] |= 1u << (cell & 31);
+    }
+
+    u32 numFree = 0;
+    for (u16 y = 0; y < a->spawnHeight; y++) {
+        for (u16 x = 0; x < a->spawnWidth; x++) {
+            u32 cell = (a->spawnY + y) * a->config.boardWidth + a->spawnX + x;
+            u16 spawnCell = y * a->spawnWidth + x;
+            u16 slot = a->freeCellSlot[spawnCell];
+
+            if ((traced[cell >> 5] >> (cell & 31)) & 1) {
+                if (slot != NO_FREE_CELL) return 0;
+            } else {
+                if (slot >= a->numFreeCells || a->freeCells[slot] != spawnCell) return 0;
+                numFree++;
+            }
+        }
+    }
+
+    return a->numFreeCells == numFree;
+}
+
+static int printUsage(const char *name) {
+    fprintf(stderr, "usage: %s [-g games] [-s seed] [-n maxTicks] [-e bitboard|segments]\n", name);
+    return 1;
+}
+
+static void printGame(const char *name, Game *g) {
+    Snake *s = &g->snake;
+
+    printf("  %s: cycle %u score %u rng %u\n", name, g->currentCycle, g->score, g->rng.seed);
+    printf("  %s: head %u,%u length %u/%u facing %u dead %u\n", name,
+        s->head.x, s->head.y, s->length, s->growToLength, s->facing, s->dead);
+
+    printf("  %s: foods", name);
+    for (u16 i = 0; i < g->numFoods; i++) {
+        printf(" %u,%u@%u", g->foods[i].location.x, g->foods[i].location.y, g->foods[i].deleteOnCycle);
+    }
+    printf("\n");
+}
+
+int main(int argc, char **argv) {
+    u64 games = 10000;
+    u32 baseSeed = RANDOM_SEED;
+    u32 maxTicks = 20000;
+    u8 engine = ENGINE_BITBOARD;
+
+    int option;
+    while ((option = getopt(argc, argv, "g:s:n:e:")) != -1) {
+        switch (option) {
+            case 'g':
+                games = strtoull(optarg, NULL, 10);
+                break;
+            case 's':
+                baseSeed = strtoul(optarg, NULL, 10);
+                break;
+            case 'n':
+                maxTicks = strtoul(optarg, NULL, 10);
+                break;
+            case 'e':
+                if (!strcmp(optarg, "bitboard")) {
+                    engine = ENGINE_BITBOARD;
+                } else if (!strcmp(optarg, "segments")) {
+                    engine = ENGINE_SEGMENTS;
+                } else {
+                    return printUsage(argv[0]);
+                }
+                break;
+            default:
+                return printUsage(argv[0]);
+        }
+    }
+
+    void *memoryA = malloc(GAME_ARENA_SIZE);
+    void *memoryB = malloc(GAME_ARENA_SIZE);
+    void *memoryC = malloc(GAME_ARENA_SIZE);
+    if (!memoryA || !memoryB || !memoryC) {
+        fprintf(stderr, "%s: out of memory\n", argv[0]);
+        return 1;
+    }
+
+    u64 ticks = 0;
+
+    for (u64 i = 0; i < games; i++) {
+        u32 seed = baseSeed + i;
+        GameConfig config = getDiffConfig(i % BOARDS);
+        PlayerPolicy policy = (i / BOARDS) % NUM_PLAYER_POLICIES;
+
+        Game *a = initGame(memoryA, &config, seed);
+        Game *b = initGame(memoryB, &config, seed);
+        if (!a || !b || !setGameEngine(a, engine) || !setGameEngine(b, ENGINE_REFERENCE)) {
+            fprintf(stderr, "%s: out of memory\n", argv[0]);
+            return 1;
+        }
+
+        Rng player;
+        seedPlayer(&player, seed);
+
+        int same = 1;
+        while (same && !a->snake.dead && a->currentCycle < maxTicks) {
+            u32 input = choosePlayerInput(a, &player, policy);
+            processGame(a, input);
+            processGame(b, input);
+            same = isSameTick(a, b);
+
+            // Now and then carry on with a copy of the reference game, which
+            // rebuilds its turn list from the snake's own turns
+            if (same && b->currentCycle % COPY_INTERVAL == 0) {
+                Game *copy = cloneGame(memoryC, b);
+                if (!copy) {
+                    fprintf(stderr, "%s: out of memory\n", argv[0]);
+                    return 1;
+                }
+
+                releaseGame(b);
+                b = copy;
+
+                void *memory = memoryB;
+                memoryB = memoryC;
+                memoryC = memory;
+            }
+        }
+
+        if (same) {
+            same = isSameGame(a, b);
+        }
+
+        if (!same) {
+            printf("game %llu (seed %u, %ux%u board, %s player) differs on cycle %u\n",
+                i, seed, config.boardWidth, config.boardHeight, getPolicyName(policy), a->currentCycle);
+            printGame("optimized", a);
+            printGame("reference", b);
+            return 1;
+        }
+
+        ticks += a->currentCycle;
+        releaseGame(a);
+        releaseGame(b);
+    }
+
+    printf("%llu games, %llu ticks: the engines agree\n", games, ticks);
+
+    free(memoryA);
+    free(memoryB);
+    free(memoryC);
+    return 0;
+}
@@ -0,0 +1,349 @@
+// Runs many independent games headless on every core and reports how they went.
+//
+// usage: cnakeFarm [-g games] [-t threads] [-p pool] [-s seed] [-m mapSize] [-n maxTicks]
+//
+// Game i is seeded from (seed, i) alone, so the report does not depend on the
+// number of threads or on how the games were scheduled.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "cnake.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/** Width of one bucket of the score histogram */
+#define SCORE_BUCKET_WIDTH 500
+
+/** Number of buckets of the score histogram, the last one also holds every larger score */
+#define SCORE_BUCKETS 64
+
+/** Number of causes a farmed game can end with: the DeathCauses plus running out of ticks */
+#define END_CAUSES (NUM_DEATH_CAUSES + 1)
+
+/** End cause of a game that was still alive after maxTicks */
+#define END_TIMEOUT NUM_DEATH_CAUSES
+
+static const char *endCauseNames[END_CAUSES] = { "alive", "self", "wall", "memory", "timeout" };
+
+/**
+ * The FarmStats struct holds the totals of the games a worker ran. Workers
+ * keep their own and they are merged once all games are done.
+ */
+typedef struct
+{
+    u64 games;
+    u64 ticks;
+    u64 scoreSum;
+    u32 scoreMax;
+    u64 endCauses[END_CAUSES];
+    u64 scoreBuckets[SCORE_BUCKETS];
+} FarmStats;
+
+/**
+ * The FarmGame struct is one slot of a worker's game pool: a reusable
+ * memory block and the game currently running in it.
+ */
+typedef struct
+{
+    void *memory;
+    Game *game;
+    Rng player;
+} FarmGame;
+
+/**
+ * The Worker struct holds the range of game indices a worker still has to
+ * run. The owner takes indices from the front, thieves split off the back.
+ */
+typedef struct
+{
+    pthread_t thread;
+    pthread_mutex_t lock;
+    u64 next;
+    u64 end;
+    FarmStats stats;
+    u8 outOfMemory;
+} Worker;
+
+static Worker *workers;
+static u32 numWorkers;
+static u32 poolSize = 8;
+static u32 baseSeed = RANDOM_SEED;
+static u32 maxTicks = 100000;
+static GameConfig config;
+
+/**
+ * Derives the seed of a game from the base seed and the game's index.
+ */
+static u32 gameSeed(u64 index) {
+    u64 x = ((u64) baseSeed << 32 | (u32) index) ^ (index >> 32) * 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return (u32) (x ^ (x >> 31));
+}
+
+/**
+ * Takes the next game index from a worker's own range.
+ */
+static int takeOwn(Worker *w, u64 *index) {
+    int found = 0;
+
+    pthread_mutex_lock(&w->lock);
+    if (w->next < w->end) {
+        *index = w->next++;
+        found = 1;
+    }
+    pthread_mutex_unlock(&w->lock);
+
+    return found;
+}
+
+/**
+ * Steals the back half of another worker's range into the thief's own range,
+ * then takes the first stolen index. Returns 0 once every range is empty.
+ */
+static int steal(Worker *thief, u64 *index) {
+    u32 self = thief - workers;
+
+    for (u32 i = 1; i < numWorkers; i++) {
+        Worker *victim = &workers[(self + i) % numWorkers];
+        u64 begin = 0, end = 0;
+
+        pthread_mutex_lock(&victim->lock);
+        if (victim->next < victim->end) {
+            end = victim->end;
+            begin = victim->next + (victim->end - victim->next) / 2;
+            victim->end = begin;
+        }
+        pthread_mutex_unlock(&victim->lock);
+
+        if (begin < end) {
+            pthread_mutex_lock(&thief->lock);
+            thief->next = begin + 1;
+            thief->end = end;
+            pthread_mutex_unlock(&thief->lock);
+
+            *index = begin;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Adds a finished game to a worker's totals.
+ */
+static void recordGame(FarmStats *stats, Game *g) {
+    u32 bucket = g->score / SCORE_BUCKET_WIDTH;
+
+    stats->games++;
+    stats->ticks += g->currentCycle;
+    stats->scoreSum += g->score;
+    if (g->score > stats->scoreMax) stats->scoreMax = g->score;
+    stats->endCauses[g->snake.dead ? g->snake.dead : END_TIMEOUT]++;
+    stats->scoreBuckets[bucket < SCORE_BUCKETS ? bucket : SCORE_BUCKETS - 1]++;
+}
+
+/**
+ * Starts the game with the given index in a pool slot. Returns 0 if there
+ * was no memory for the game.
+ */
+static int startGame(FarmGame *slot, u64 index) {
+    u32 seed = gameSeed(index);
+
+    slot->game = initGame(slot->memory, &config, seed);
+    if (!slot->game) return 0;
+
+    seedPlayer(&slot->player, seed);
+    return 1;
+}
+
+/**
+ * Runs a worker: keeps every slot of its game pool busy, ticking the games
+ * round robin, until there is no game left to take or steal. A worker that
+ * runs out of memory stops and flags it.
+ */
+static void* runWorker(void *argument) {
+    Worker *w = argument;
+    FarmGame *pool = calloc(poolSize, sizeof(FarmGame));
+    u32 running = 0;
+
+    if (!pool) {
+        w->outOfMemory = 1;
+        return NULL;
+    }
+
+    for (u32 i = 0; i < poolSize && !w->outOfMemory; i++) {
+        u64 index;
+        pool[i].memory = malloc(GAME_ARENA_SIZE);
+        if (!pool[i].memory) {
+            w->outOfMemory = 1;
+        } else if (takeOwn(w, &index) || steal(w, &index)) {
+            if (startGame(&pool[i], index)) running++;
+            else w->outOfMemory = 1;
+        }
+    }
+
+    while (running > 0 && !w->outOfMemory) {
+        for (u32 i = 0; i < poolSize; i++) {
+            Game *g = pool[i].game;
+            if (!g) continue;
+
+            processGame(g, choosePlayerInput(g, &pool[i].player, PLAYER_GREEDY));
+
+            if (g->snake.dead || g->currentCycle >= maxTicks) {
+                u64 index;
+                recordGame(&w->stats, g);
+                releaseGame(g);
+                pool[i].game = NULL;
+                running--;
+
+                if (takeOwn(w, &index) || steal(w, &index)) {
+                    if (startGame(&pool[i], index)) running++;
+                    else w->outOfMemory = 1;
+                }
+            }
+        }
+    }
+
+    for (u32 i = 0; i < poolSize; i++) {
+        if (pool[i].game) releaseGame(pool[i].game);
+        free(pool[i].memory);
+    }
+    free(pool);
+
+    return NULL;
+}
+
+/**
+ * Finds the lower bound of the score bucket a percentile of the games falls in.
+ */
+static u32 scorePercentile(FarmStats *stats, u32 percent) {
+    u64 target = (stats->games * percent + 99) / 100;
+    u64 seen = 0;
+
+    for (u32 i = 0; i < SCORE_BUCKETS; i++) {
+        seen += stats->scoreBuckets[i];
+        if (seen >= target && seen > 0) return i * SCORE_BUCKET_WIDTH;
+    }
+
+    return (SCORE_BUCKETS - 1) * SCORE_BUCKET_WIDTH;
+}
+
+static void printReport(FarmStats *stats, double seconds) {
+    printf("games            %llu\n", stats->games);
+    printf("ticks            %llu\n", stats->ticks);
+    printf("seconds          %.3f\n", seconds);
+    printf("ticks/second     %.0f\n", stats->ticks / seconds);
+    printf("games/second     %.0f\n", stats->games / seconds);
+    printf("score mean       %.1f\n", stats->games ? (double) stats->scoreSum / stats->games : 0.0);
+    printf("score max        %u\n", stats->scoreMax);
+    printf("score p10/50/90/99 >= %u / %u / %u / %u\n",
+        scorePercentile(stats, 10), scorePercentile(stats, 50),
+        scorePercentile(stats, 90), scorePercentile(stats, 99));
+
+    for (u32 i = 1; i < END_CAUSES; i++) {
+        printf("ended by %-7s %llu\n", endCauseNames[i], stats->endCauses[i]);
+    }
+
+    printf("score histogram:\n");
+    for (u32 i = 0; i < SCORE_BUCKETS; i++) {
+        if (!stats->scoreBuckets[i]) continue;
+        printf("  %6u%s %llu\n", i * SCORE_BUCKET_WIDTH, i == SCORE_BUCKETS - 1 ? "+" : " ", stats->scoreBuckets[i]);
+    }
+}
+
+int main(int argc, char **argv) {
+    u64 games = 100000;
+    u16 mapSize = 0;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    numWorkers = cores > 0 ? cores : 1;
+
+    int option;
+    while ((option = getopt(argc, argv, "g:t:p:s:m:n:")) != -1) {
+        switch (option) {
+            case 'g':
+                games = strtoull(optarg, NULL, 10);
+                break;
+            case 't':
+                numWorkers = strtoul(optarg, NULL, 10);
+                break;
+            case 'p':
+                poolSize = strtoul(optarg, NULL, 10);
+                break;
+            case 's':
+                baseSeed = strtoul(optarg, NULL, 10);
+                break;
+            case 'm':
+                mapSize = strtoul(optarg, NULL, 10);
+                break;
+            case 'n':
+                maxTicks = strtoul(optarg, NULL, 10);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-g games] [-t threads] [-p pool] [-s seed] [-m mapSize] [-n maxTicks]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (numWorkers == 0) numWorkers = 1;
+    if (poolSize == 0) poolSize = 1;
+    config = getMapConfig(mapSize);
+
+    // Hand every worker an equal share of the game indices up front
+    workers = calloc(numWorkers, sizeof(Worker));
+    if (!workers) {
+        fprintf(stderr, "%s: out of memory\n", argv[0]);
+        return 1;
+    }
+
+    for (u32 i = 0; i < numWorkers; i++) {
+        pthread_mutex_init(&workers[i].lock, NULL);
+        workers[i].next = games * i / numWorkers;
+        workers[i].end = games * (i + 1) / numWorkers;
+    }
+
+    struct timespec start, stop;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (u32 i = 0; i < numWorkers; i++) {
+        pthread_create(&workers[i].thread, NULL, runWorker, &workers[i]);
+    }
+
+    FarmStats total;
+    memset(&total, 0, sizeof(total));
+    u8 outOfMemory = 0;
+
+    for (u32 i = 0; i < numWorkers; i++) {
+        FarmStats *stats = &workers[i].stats;
+        pthread_join(workers[i].thread, NULL);
+        pthread_mutex_destroy(&workers[i].lock);
+        outOfMemory |= workers[i].outOfMemory;
+
+        total.games += stats->games;
+        total.ticks += stats->ticks;
+        total.scoreSum += stats->scoreSum;
+        if (stats->scoreMax > total.scoreMax) total.scoreMax = stats->scoreMax;
+        for (u32 j = 0; j < END_CAUSES; j++) total.endCauses[j] += stats->endCauses[j];
+        for (u32 j = 0; j < SCORE_BUCKETS; j++) total.scoreBuckets[j] += stats->scoreBuckets[j];
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    double seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+
+    if (outOfMemory) {
+        fprintf(stderr, "%s: out of memory\n", argv[0]);
+        free(workers);
+        return 1;
+    }
+
+    printf("threads          %u (pool of %u games each)\n", numWorkers, poolSize);
+    printReport(&total, seconds);
+
+    free(workers);
+    return 0;
+}
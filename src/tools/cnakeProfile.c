@@ -0,0 +1,149 @@
+// Plays complete games with every scripted player on the SMALL, LARGE and
+// any custom boards while processGame times its phases, and dumps the phase
+// histograms split by how long the snake was on the tick.
+//
+// usage: cnakeProfile [-g games] [-s seed] [-n maxTicks] [-b WIDTHxHEIGHT]...
+//
+// The phases are timed with clock_gettime, less what reading it costs, so
+// the cheapest phases can show as taking no time. The share column is what
+// each phase takes of the ticks of its length bracket.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "cnake.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/** Largest number of boards a run can profile, the SMALL and LARGE ones included */
+#define MAX_BOARDS 16
+
+/** Number of snake length brackets the ticks are split into */
+#define LENGTH_BRACKETS 5
+
+/** Shortest snake of each bracket */
+static const u32 bracketLengths[LENGTH_BRACKETS] = { 0, 64, 256, 1024, 4096 };
+
+static TickProfile profiles[LENGTH_BRACKETS];
+
+static u32 readClock(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (u32) ((u64) t.tv_sec * 1000000000u + t.tv_nsec);
+}
+
+static u32 getBracket(u32 length) {
+    u32 bracket = LENGTH_BRACKETS - 1;
+    while (length < bracketLengths[bracket]) bracket--;
+    return bracket;
+}
+
+/**
+ * Prints one line per phase of one length bracket's profile.
+ */
+static void dumpProfile(const char *board, const char *lengths, TickProfile *p) {
+    u64 tickTotal = 0;
+    for (u32 i = 0; i < NUM_TICK_PHASES; i++) tickTotal += p->phases[i].total;
+
+    for (u32 i = 0; i < NUM_TICK_PHASES; i++) {
+        PhaseHistogram *h = &p->phases[i];
+        if (!h->samples) continue;
+
+        printf("%-10s %-11s %-10s %10u %9.1f %8u %8u %8u %6.1f%%\n",
+            board, lengths, getPhaseName(i), h->samples, (double) h->total / h->samples,
+            getPhasePercentile(h, 50), getPhasePercentile(h, 99), h->max,
+            100.0 * h->total / tickTotal);
+    }
+}
+
+int main(int argc, char **argv) {
+    GameConfig configs[MAX_BOARDS];
+    char *boardNames[MAX_BOARDS] = { "small", "large" };
+    u32 numBoards = 2;
+    u32 games = 200;
+    u32 maxTicks = 20000;
+    u32 baseSeed = RANDOM_SEED;
+
+    configs[0] = getMapConfig(0);
+    configs[1] = getMapConfig(1);
+
+    int option;
+    while ((option = getopt(argc, argv, "g:s:n:b:")) != -1) {
+        switch (option) {
+            case 'g':
+                games = strtoul(optarg, NULL, 10);
+                break;
+            case 's':
+                baseSeed = strtoul(optarg, NULL, 10);
+                break;
+            case 'n':
+                maxTicks = strtoul(optarg, NULL, 10);
+                break;
+            case 'b':
+                if (numBoards == MAX_BOARDS || !parseBoardConfig(optarg, &configs[numBoards])) {
+                    fprintf(stderr, "%s: cannot use board %s\n", argv[0], optarg);
+                    return 1;
+                }
+                boardNames[numBoards++] = optarg;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-g games] [-s seed] [-n maxTicks] [-b WIDTHxHEIGHT]...\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (!PROFILE_TICKS) {
+        fprintf(stderr, "%s: built with PROFILE_TICKS off, nothing to profile\n", argv[0]);
+        return 1;
+    }
+
+    printf("%u games per player and board, at most %u ticks per game, times in ns\n", games, maxTicks);
+    printf("%-10s %-11s %-10s %10s %9s %8s %8s %8s %7s\n",
+        "board", "length", "phase", "samples", "mean", "p50", "p99", "max", "share");
+
+    for (u32 b = 0; b < numBoards; b++) {
+        for (u32 i = 0; i < LENGTH_BRACKETS; i++) {
+            initTickProfile(&profiles[i], readClock, 1000000000u);
+        }
+
+        for (u32 p = 0; p < NUM_PLAYER_POLICIES; p++) {
+            for (u32 i = 0; i < games; i++) {
+                u32 seed = baseSeed + i;
+                Game *g = createGame(&configs[b], seed);
+                if (!g) {
+                    fprintf(stderr, "%s: out of memory\n", argv[0]);
+                    return 1;
+                }
+
+                Rng player;
+                seedPlayer(&player, seed);
+
+                while (!g->snake.dead && g->currentCycle < maxTicks) {
+                    u32 input = choosePlayerInput(g, &player, p);
+
+                    // Record the tick into the bracket of the snake's length
+                    tickProfile = &profiles[getBracket(g->snake.length)];
+                    processGame(g, input);
+                }
+
+                freeGame(g);
+            }
+        }
+
+        tickProfile = NULL;
+
+        for (u32 i = 0; i < LENGTH_BRACKETS; i++) {
+            char lengths[16];
+            if (i < LENGTH_BRACKETS - 1) {
+                sprintf(lengths, "%u-%u", bracketLengths[i], bracketLengths[i + 1] - 1);
+            } else {
+                sprintf(lengths, "%u+", bracketLengths[i]);
+            }
+
+            dumpProfile(boardNames[b], lengths, &profiles[i]);
+        }
+    }
+
+    return 0;
+}
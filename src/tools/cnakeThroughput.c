@@ -0,0 +1,250 @@
+// Plays complete games through createGame, processGame and freeGame with
+// every scripted player on the SMALL, LARGE and any custom boards, and
+// reports ticks per second per core and games per second.
+//
+// usage: cnakeThroughput [-g games] [-t threads] [-s seed] [-n maxTicks] [-B batchSize [-l]] [-b WIDTHxHEIGHT]...
+//
+// Every thread plays the same number of games on its own, so with more than
+// one thread the per-core figure shows how well the engine scales. With -B
+// the games are played in lockstep batches of that many instead, stepped
+// with processGameBatch, or with -l by calling processGame on every game of
+// the batch in turn. Either way the games are the same.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "cnake.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/** Largest number of boards a run can measure, the SMALL and LARGE ones included */
+#define MAX_BOARDS 16
+
+/**
+ * The Run struct holds what one thread is asked to play and what came of
+ * it.
+ */
+typedef struct
+{
+    pthread_t thread;
+    GameConfig *config;
+    PlayerPolicy policy;
+    u32 firstSeed;
+    u64 ticks;
+    u64 scoreSum;
+    u8 outOfMemory;
+} Run;
+
+static u32 gamesPerThread = 1000;
+static u32 maxTicks = 20000;
+static u32 batchSize = 0;
+static u8 loopBatches = 0;
+
+/**
+ * Plays a thread's share of games in batches, all the games of a batch
+ * stepped together until every one of them is over. Stops early and flags
+ * the run if a batch or one of its games cannot be allocated.
+ */
+static void playBatches(Run *run) {
+    Game **games = malloc(batchSize * sizeof(Game*));
+    Rng *players = malloc(batchSize * sizeof(Rng));
+    u32 *inputs = malloc(batchSize * sizeof(u32));
+
+    if (!games || !players || !inputs) run->outOfMemory = 1;
+
+    for (u32 first = 0; first < gamesPerThread && !run->outOfMemory; first += batchSize) {
+        u32 size = gamesPerThread - first < batchSize ? gamesPerThread - first : batchSize;
+
+        for (u32 i = 0; i < size; i++) {
+            games[i] = createGame(run->config, run->firstSeed + first + i);
+            if (!games[i]) {
+                while (i > 0) freeGame(games[--i]);
+                run->outOfMemory = 1;
+                break;
+            }
+
+            seedPlayer(&players[i], run->firstSeed + first + i);
+        }
+
+        if (run->outOfMemory) break;
+
+        GameBatch *b = createGameBatch(games, size);
+        if (!b) {
+            for (u32 i = 0; i < size; i++) freeGame(games[i]);
+            run->outOfMemory = 1;
+            break;
+        }
+
+        // The games start together and go on in lockstep until they die
+        u32 live = size;
+        for (u32 t = 0; t < maxTicks && live > 0; t++) {
+            live = 0;
+            for (u32 i = 0; i < size; i++) {
+                Game *g = games[i];
+                inputs[i] = g->snake.dead ? INPUT_NONE : choosePlayerInput(g, &players[i], run->policy);
+                live += !g->snake.dead;
+            }
+
+            if (loopBatches) {
+                for (u32 i = 0; i < size; i++) {
+                    if (!games[i]->snake.dead) processGame(games[i], inputs[i]);
+                }
+            } else {
+                processGameBatch(b, inputs);
+            }
+        }
+
+        for (u32 i = 0; i < size; i++) {
+            run->ticks += games[i]->currentCycle;
+            run->scoreSum += games[i]->score;
+            freeGame(games[i]);
+        }
+
+        freeGameBatch(b);
+    }
+
+    free(inputs);
+    free(players);
+    free(games);
+}
+
+/**
+ * Plays a thread's share of games one after the other. Stops early and
+ * flags the run if a game cannot be allocated.
+ */
+static void* playGames(void *argument) {
+    Run *run = argument;
+
+    if (batchSize) {
+        playBatches(run);
+        return NULL;
+    }
+
+    for (u32 i = 0; i < gamesPerThread; i++) {
+        u32 seed = run->firstSeed + i;
+        Game *g = createGame(run->config, seed);
+        if (!g) {
+            run->outOfMemory = 1;
+            break;
+        }
+
+        Rng player;
+        seedPlayer(&player, seed);
+
+        while (!g->snake.dead && g->currentCycle < maxTicks) {
+            processGame(g, choosePlayerInput(g, &player, run->policy));
+        }
+
+        run->ticks += g->currentCycle;
+        run->scoreSum += g->score;
+        freeGame(g);
+    }
+
+    return NULL;
+}
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv) {
+    GameConfig configs[MAX_BOARDS];
+    char *boardNames[MAX_BOARDS] = { "small", "large" };
+    u32 numBoards = 2;
+    u32 numThreads = 1;
+    u32 baseSeed = RANDOM_SEED;
+
+    configs[0] = getMapConfig(0);
+    configs[1] = getMapConfig(1);
+
+    int option;
+    while ((option = getopt(argc, argv, "g:t:s:n:B:lb:")) != -1) {
+        switch (option) {
+            case 'g':
+                gamesPerThread = strtoul(optarg, NULL, 10);
+                break;
+            case 't':
+                numThreads = strtoul(optarg, NULL, 10);
+                break;
+            case 's':
+                baseSeed = strtoul(optarg, NULL, 10);
+                break;
+            case 'n':
+                maxTicks = strtoul(optarg, NULL, 10);
+                break;
+            case 'B':
+                batchSize = strtoul(optarg, NULL, 10);
+                break;
+            case 'l':
+                loopBatches = 1;
+                break;
+            case 'b':
+                if (numBoards == MAX_BOARDS || !parseBoardConfig(optarg, &configs[numBoards])) {
+                    fprintf(stderr, "%s: cannot use board %s\n", argv[0], optarg);
+                    return 1;
+                }
+                boardNames[numBoards++] = optarg;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-g games] [-t threads] [-s seed] [-n maxTicks] [-B batchSize [-l]] [-b WIDTHxHEIGHT]...\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (numThreads == 0) numThreads = 1;
+    Run *runs = calloc(numThreads, sizeof(Run));
+    if (!runs) {
+        fprintf(stderr, "%s: out of memory\n", argv[0]);
+        return 1;
+    }
+
+    printf("%u thread(s), %u games each, at most %u ticks per game\n", numThreads, gamesPerThread, maxTicks);
+    printf("%-10s %-14s %10s %12s %14s %10s %10s %10s\n",
+        "board", "player", "games", "ticks", "ticks/s/core", "games/s", "mean ticks", "mean score");
+
+    for (u32 b = 0; b < numBoards; b++) {
+        for (u32 p = 0; p < NUM_PLAYER_POLICIES; p++) {
+            double start = now();
+
+            for (u32 i = 0; i < numThreads; i++) {
+                runs[i].config = &configs[b];
+                runs[i].policy = p;
+                runs[i].firstSeed = baseSeed + i * gamesPerThread;
+                runs[i].ticks = 0;
+                runs[i].scoreSum = 0;
+                runs[i].outOfMemory = 0;
+                pthread_create(&runs[i].thread, NULL, playGames, &runs[i]);
+            }
+
+            u64 ticks = 0, scoreSum = 0;
+            u8 outOfMemory = 0;
+            for (u32 i = 0; i < numThreads; i++) {
+                pthread_join(runs[i].thread, NULL);
+                ticks += runs[i].ticks;
+                scoreSum += runs[i].scoreSum;
+                outOfMemory |= runs[i].outOfMemory;
+            }
+
+            if (outOfMemory) {
+                fprintf(stderr, "%s: out of memory\n", argv[0]);
+                return 1;
+            }
+
+            double seconds = now() - start;
+            u64 games = (u64) gamesPerThread * numThreads;
+
+            printf("%-10s %-14s %10llu %12llu %14.0f %10.0f %10.1f %10.1f\n",
+                boardNames[b], getPolicyName(p), games, ticks,
+                ticks / seconds / numThreads, games / seconds,
+                games ? (double) ticks / games : 0.0,
+                games ? (double) scoreSum / games : 0.0);
+        }
+    }
+
+    free(runs);
+    return 0;
+}